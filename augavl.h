@@ -0,0 +1,218 @@
+#ifndef AUGAVL_H
+#define AUGAVL_H
+
+#include <stdexcept>
+#include <limits>
+#include "avlbst.h"
+
+/**
+* An AVL tree that also keeps, in every node, a monoid aggregate over the
+* items of that node's subtree, so aggregates over any key range take
+* O(log n) instead of a scan.
+*
+* The Monoid policy supplies:
+*   typedef ... type;                          the aggregate type
+*   static type identity();                    combine(identity(), x) == x
+*   static type lift(const Key&, const Value&);  aggregate of one item
+*   static type combine(const type&, const type&);  associative
+* combine is always called with the smaller keys on the left, so it does
+* not need to be commutative. SumMonoid, MinMonoid and MaxMonoid below
+* aggregate the values.
+*
+* The aggregates are refreshed by the AVLTree hooks: along the path to the
+* root on insert, remove, overwrite and lazy removal, and locally on each
+* rotation. Tombstones (lazy deletion) count as identity().
+*/
+template <class Key, class Value, class Aggregate>
+class AugmentedNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, const Aggregate& aggregate);
+
+    const Aggregate& getAggregate() const;
+    void setAggregate(const Aggregate& aggregate);
+
+protected:
+    Aggregate aggregate_;
+};
+
+template<class Key, class Value, class Aggregate>
+AugmentedNode<Key, Value, Aggregate>::AugmentedNode(const Key& key, const Value& value,
+    AVLNode<Key, Value>* parent, const Aggregate& aggregate) :
+    AVLNode<Key, Value>(key, value, parent), aggregate_(aggregate)
+{
+
+}
+
+template<class Key, class Value, class Aggregate>
+const Aggregate& AugmentedNode<Key, Value, Aggregate>::getAggregate() const
+{
+    return aggregate_;
+}
+
+template<class Key, class Value, class Aggregate>
+void AugmentedNode<Key, Value, Aggregate>::setAggregate(const Aggregate& aggregate)
+{
+    aggregate_ = aggregate;
+}
+
+/**
+* Ready-made monoids over the values.
+*/
+template <class Value>
+struct SumMonoid
+{
+    typedef Value type;
+    static type identity() { return Value(); }
+    template <class Key>
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return a + b; }
+};
+
+template <class Value>
+struct MinMonoid
+{
+    typedef Value type;
+    static type identity() { return std::numeric_limits<Value>::max(); }
+    template <class Key>
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return b < a ? b : a; }
+};
+
+template <class Value>
+struct MaxMonoid
+{
+    typedef Value type;
+    static type identity() { return std::numeric_limits<Value>::lowest(); }
+    template <class Key>
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return a < b ? b : a; }
+};
+
+template <class Key, class Value, class Monoid>
+class AugmentedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename Monoid::type Aggregate;
+
+    AugmentedAVLTree();
+
+    // Aggregate of the whole tree, and of the items with lo <= key <= hi
+    Aggregate aggregate() const;
+    Aggregate aggregate(const Key& lo, const Key& hi) const;
+
+    // Changes the value of an existing key (std::out_of_range if missing),
+    // refreshing only the aggregates on its path to the root.
+    void update_value(const Key& key, const Value& value);
+
+protected:
+    typedef AugmentedNode<Key, Value, Aggregate> AugNode;
+
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void refresh(AVLNode<Key, Value>* n);
+    static Aggregate subtree(Node<Key, Value>* n);
+    static Aggregate item(Node<Key, Value>* n);
+};
+
+template<class Key, class Value, class Monoid>
+AugmentedAVLTree<Key, Value, Monoid>::AugmentedAVLTree()
+{
+    this->augmented_ = true;
+}
+
+template<class Key, class Value, class Monoid>
+AVLNode<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::createNode(const Key& key, const Value& value,
+    AVLNode<Key, Value>* parent)
+{
+    return new AugNode(key, value, parent, Monoid::lift(key, value));
+}
+
+/**
+* Recomputes n's aggregate from its children, which must be up to date.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refresh(AVLNode<Key, Value>* n)
+{
+    Aggregate a = Monoid::combine(subtree(n->getLeft()), item(n));
+    static_cast<AugNode*>(n)->setAggregate(Monoid::combine(a, subtree(n->getRight())));
+}
+
+// Aggregate of the subtree at n (identity for NULL)
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Aggregate
+AugmentedAVLTree<Key, Value, Monoid>::subtree(Node<Key, Value>* n)
+{
+    if(n == NULL)
+        return Monoid::identity();
+    return static_cast<AugNode*>(n)->getAggregate();
+}
+
+// Aggregate of n's own item (identity for a tombstone)
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Aggregate
+AugmentedAVLTree<Key, Value, Monoid>::item(Node<Key, Value>* n)
+{
+    if(n->isTombstone())
+        return Monoid::identity();
+    return Monoid::lift(n->getKey(), n->getValue());
+}
+
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Aggregate
+AugmentedAVLTree<Key, Value, Monoid>::aggregate() const
+{
+    return subtree(this->root_);
+}
+
+/**
+* Walks down to the first node inside [lo, hi], then down both edges of
+* the range: on the way to lo every node >= lo adds itself and its whole
+* right subtree, on the way to hi every node <= hi adds its left subtree
+* and itself. O(log n).
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Aggregate
+AugmentedAVLTree<Key, Value, Monoid>::aggregate(const Key& lo, const Key& hi) const
+{
+    Node<Key, Value>* split = this->root_;
+    while(split != NULL && (split->getKey() < lo || hi < split->getKey()))
+        split = (split->getKey() < lo) ? split->getRight() : split->getLeft();
+    if(split == NULL)
+        return Monoid::identity();
+
+    Aggregate left = Monoid::identity();
+    for(Node<Key, Value>* n = split->getLeft(); n != NULL; )
+    {
+        if(n->getKey() < lo)
+            n = n->getRight();
+        else
+        {
+            left = Monoid::combine(Monoid::combine(item(n), subtree(n->getRight())), left);
+            n = n->getLeft();
+        }
+    }
+    Aggregate right = Monoid::identity();
+    for(Node<Key, Value>* n = split->getRight(); n != NULL; )
+    {
+        if(hi < n->getKey())
+            n = n->getLeft();
+        else
+        {
+            right = Monoid::combine(right, Monoid::combine(subtree(n->getLeft()), item(n)));
+            n = n->getRight();
+        }
+    }
+    return Monoid::combine(Monoid::combine(left, item(split)), right);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::update_value(const Key& key, const Value& value)
+{
+    AVLNode<Key, Value>* n = this->internalFind(key);
+    if(n == NULL || n->isTombstone())
+        throw std::out_of_range("Invalid key");
+    n->setValue(value);
+    this->refreshPath(n);
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
 #include "bst.h"
 
 struct KeyError { };
@@ -35,8 +36,13 @@ public:
     virtual AVLNode<Key, Value>* getLeft() const override;
     virtual AVLNode<Key, Value>* getRight() const override;
 
+    // Lazily deleted nodes stay in the tree, marked as tombstones
+    virtual bool isTombstone() const override;
+    void setTombstone(bool tombstone);
+
 protected:
     int8_t balance_;    // effectively a signed char
+    bool tombstone_;    // fits in the padding after balance_
 };
 
 /*
@@ -50,7 +56,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), tombstone_(false)
 {
 
 }
@@ -107,7 +113,7 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    return static_cast<AVLNode<Key, Value>*>(Node<Key, Value>::getLeft());
 }
 
 /**
@@ -116,10 +122,28 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
 template<class Key, class Value>
 AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    return static_cast<AVLNode<Key, Value>*>(Node<Key, Value>::getRight());
 }
 
 
+/**
+* True if the node has been lazily removed.
+*/
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isTombstone() const
+{
+    return tombstone_;
+}
+
+/**
+* Marks or unmarks the node as lazily removed.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setTombstone(bool tombstone)
+{
+    tombstone_ = tombstone;
+}
+
 /*
   -----------------------------------------------
   End implementations for the AVLNode class.
@@ -131,8 +155,28 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    AVLTree();
+    using BinarySearchTree<Key, Value>::insert;
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
     virtual void remove(const Key& key);  // TODO
+    virtual void clear();
+    virtual void rebalance();
+
+    // Lazy deletion: remove() only marks the node as a tombstone, without
+    // any restructuring. Tombstones are physically removed only by
+    // compact() or compact_step(); needsCompaction() says when it is due.
+    void setLazyDelete(bool enabled, double maxTombstoneRatio = 0.25);
+    bool lazyDelete() const;
+    size_t tombstones() const;
+    bool needsCompaction() const;
+    void compact();
+    size_t compact_step(size_t budget);
+
+    // Replaces the contents with the (key, value) pairs in [first, last),
+    // in any order, using threads threads (0: one per hardware thread).
+    // Duplicate keys keep the last value, as repeated insert() would.
+    template<class InputIt>
+    void build_parallel(InputIt first, InputIt last, unsigned threads = 0);
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
@@ -140,14 +184,44 @@ protected:
     virtual void rotateRight(AVLNode<Key,Value>* n); 
     virtual void rotateLeft(AVLNode<Key,Value>* n);
     int calcBalance(AVLNode<Key,Value>* n);
+    int resetBalances(AVLNode<Key,Value>* n);
+    void buildRange(const std::pair<Key, Value>* items, size_t lo, size_t hi,
+        AVLNode<Key,Value>* parent, bool asLeft, int forkDepth, TaskPool* pool);
+    static int rangeHeight(size_t count);
     void insertFix(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p);
     void removeFix(AVLNode<Key,Value>* p, int diff);
     AVLNode<Key, Value>* internalFind(const Key& key) const;
 		AVLNode<Key, Value>* predecessor(AVLNode<Key, Value>* current);
+    void removeNode(AVLNode<Key, Value>* rmvNode);
+    virtual void removeNode(Node<Key, Value>* rmvNode);
+    virtual Node<Key, Value>* linkNew(Node<Key, Value>* parent, bool asLeft,
+        const std::pair<const Key, Value>& new_item);
+    virtual void overwrite(Node<Key, Value>* n, const Value& value);
+    virtual bool balancesItself() const;
+
+    // Hooks for trees that keep per-subtree data (see augavl.h). Nodes are
+    // made by createNode, and once augmented_ is set refresh(n) is called
+    // whenever n's subtree changed, children before parents.
+    virtual AVLNode<Key,Value>* createNode(const Key& key, const Value& value, AVLNode<Key,Value>* parent);
+    virtual void refresh(AVLNode<Key,Value>* n);
+    void refreshPath(AVLNode<Key,Value>* n);
+    void refreshTree(AVLNode<Key,Value>* n);
+
+    bool augmented_;
+    bool lazyDelete_;
+    double maxTombstoneRatio_;  // compaction is due once tombstones / nodes exceeds this
+    size_t tombstones_;
+    AVLNode<Key,Value>* compactFrom_;  // where the next compact_step resumes (NULL: leftmost)
 
+};
 
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() :
+    augmented_(false), lazyDelete_(false), maxTombstoneRatio_(0.25), tombstones_(0),
+    compactFrom_(NULL)
+{
 
-};
+}
 
 template<class Key, class Value>
 int AVLTree<Key, Value>::calcBalance(AVLNode<Key,Value>* n)
@@ -188,10 +262,16 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key,Value>* n)
 
 	if(newParent->getRight() != NULL)
 		newParent->getRight()->setParent(n);
+	else if(this->threaded_)
+		n->setLeftThread(newParent);
 	//cout << "node's new left should be " << n->getLeft()->getValue() << endl;
 	newParent->setRight(n); //set n's OG left child to have a right child of n
   //cout << "new parent's right node is " << newParent->getRight()->getValue() << endl;
 	n->setParent(newParent);
+	if(augmented_){
+		refresh(n);
+		refresh(newParent);
+	}
 	
 	
 	//cout << "after rotating right: " << endl;
@@ -226,9 +306,15 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key,Value>* n)
 	
 	if(newParent->getLeft() != NULL)
 		newParent->getLeft()->setParent(n);
+	else if(this->threaded_)
+		n->setRightThread(newParent);
 	
 	newParent->setLeft(n); //set n's OG left child to have a right child of n
 	n->setParent(newParent);
+	if(augmented_){
+		refresh(n);
+		refresh(newParent);
+	}
 	//cout << "after rotating left:" << endl;
 	//this->BinarySearchTree<Key,Value>::printRoot(this->root_);
 
@@ -470,14 +556,54 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff)
 template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
 {
-     AVLNode<Key, Value>* rmvNode = internalFind(key);
+		AVLNode<Key, Value>* rmvNode = internalFind(key);
+
+		if(rmvNode == NULL || rmvNode->isTombstone())
+			return;
 
-		if(rmvNode == NULL)
+		if(lazyDelete_)
+		{
+			rmvNode->setTombstone(true);
+			tombstones_++;
+			this->size_--;
+			refreshPath(rmvNode);
 			return;
+		}
+		removeNode(rmvNode);
+}
+
+/*
+ * Physically unlinks and frees a node, then rebalances.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(Node<Key, Value>* rmvNode)
+{
+		removeNode(static_cast<AVLNode<Key, Value>*>(rmvNode));
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNode(AVLNode<Key, Value>* rmvNode)
+{
+		this->uncacheExtremes(rmvNode);
+		if(compactFrom_ == rmvNode)
+			compactFrom_ = NULL;
+		if(rmvNode->isTombstone())
+			tombstones_--;
+		else
+			this->size_--;
+
+		//threaded mode: neighbours whose threads change, as in the base class
+		Node<Key, Value>* before = this->threaded_ ? predecessor(rmvNode) : NULL;
+		Node<Key, Value>* after = this->threaded_ ? this->successor(rmvNode) : NULL;
+		bool swapped = false;
+		Node<Key, Value>* beforePred = NULL;
 
 		if(rmvNode->getLeft() != NULL && rmvNode->getRight() != NULL) //if node has both children
 		{
 			AVLNode<Key, Value>* pred = predecessor(rmvNode);
+			if(this->threaded_)
+				beforePred = predecessor(pred);
+			swapped = true;
 			nodeSwap(pred, rmvNode);
 			if(this->root_ == rmvNode)
 				this->root_ = pred;
@@ -537,48 +663,285 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 		}
 
 		delete rmvNode;
+		if(this->threaded_)
+		{
+			this->bridgeThreads(before, after);
+			if(swapped)
+				this->bridgeThreads(beforePred, before);
+		}
+		refreshPath(parent);
 
 		removeFix(parent, diff);
 }
 
+/**
+* Turns lazy deletion on or off. Turning it off compacts right away.
+*/
 template<class Key, class Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::predecessor(AVLNode<Key, Value>* current)
+void AVLTree<Key, Value>::setLazyDelete(bool enabled, double maxTombstoneRatio)
 {
-  // TODO
-    AVLNode<Key, Value>* next = current;
-    
-    if(next != NULL)
-    {
-        if(next->getLeft() != NULL)
-        {
-            next = next->getLeft();
-            while(next->getRight() != NULL){
-                next = next->getRight();
-						}
-            return next;   
-        }
-        else if(next->getParent() != NULL)
-        {
-            next = next->getParent();
-            while(next->getParent() != NULL)
-            {
-                if(next->getParent()->getRight() == next)
-                {
-                    return next->getParent();
-                    break;
-                }
-                next = next->getParent();
-            }
-						if(current->getParent() == next)
-							return NULL;
-        }
+		lazyDelete_ = enabled;
+		maxTombstoneRatio_ = maxTombstoneRatio;
+		if(!enabled)
+			compact();
+}
+
+template<class Key, class Value>
+bool AVLTree<Key, Value>::lazyDelete() const
+{
+		return lazyDelete_;
+}
+
+/**
+* Number of lazily removed nodes still in the tree.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::tombstones() const
+{
+		return tombstones_;
+}
+
+/**
+* True when the share of tombstones among all nodes is over the threshold.
+* Nothing compacts on its own; callers check this and run compact() or
+* compact_step().
+*/
+template<class Key, class Value>
+bool AVLTree<Key, Value>::needsCompaction() const
+{
+		return tombstones_ > maxTombstoneRatio_ * (tombstones_ + this->size_);
+}
+
+/**
+* Physically removes every tombstone.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compact()
+{
+		while(tombstones_ > 0)
+			compact_step(tombstones_ + this->size_);
+}
+
+/**
+* Looks at up to budget nodes and physically removes the tombstones
+* among them, for callers that want to spread compaction out (e.g. a
+* background task calling it while needsCompaction() is true), so one
+* step costs O(budget log n). Returns how many were removed. The nodes
+* are walked in order, picking up where the last step stopped and
+* wrapping around at the end.
+*/
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::compact_step(size_t budget)
+{
+		size_t removed = 0;
+		AVLNode<Key, Value>* n = compactFrom_;
+		for(size_t visited = 0; visited < budget && tombstones_ > 0; visited++)
+		{
+			if(n == NULL)
+			{
+				n = static_cast<AVLNode<Key, Value>*>(this->root_);
+				while(n->getLeft() != NULL)
+					n = n->getLeft();
 			}
-			return NULL;
+			//removal relinks but never frees other nodes, so next stays valid
+			AVLNode<Key, Value>* next = static_cast<AVLNode<Key, Value>*>(this->successor(n));
+			if(n->isTombstone())
+			{
+				removeNode(n);
+				removed++;
+			}
+			n = next;
+		}
+		compactFrom_ = n;
+		return removed;
+}
+
+/**
+* Frees every node, tombstones included.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::clear()
+{
+		BinarySearchTree<Key, Value>::clear();
+		tombstones_ = 0;
+		compactFrom_ = NULL;
+}
+
+/*
+ * An AVL tree never needs this, but it is kept consistent: after the
+ * rebuild every balance is recomputed from the new shape.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::rebalance()
+{
+		BinarySearchTree<Key, Value>::rebalance();
+		resetBalances(static_cast<AVLNode<Key, Value>*>(this->root_));
+		refreshTree(static_cast<AVLNode<Key, Value>*>(this->root_));
+}
+
+// Makes setScapegoat throw: its rebuilds would not update the balances
+template<class Key, class Value>
+bool AVLTree<Key, Value>::balancesItself() const
+{
+		return true;
+}
+
+/*
+ * Sort (in parallel, stable), keep the last of each run of equal keys,
+ * then build the perfectly balanced tree over the sorted run top-down,
+ * with the upper levels' subtrees built as concurrent tasks. Each node's
+ * balance follows from its subtree sizes, so no pass over the finished
+ * tree is needed.
+ */
+template<class Key, class Value>
+template<class InputIt>
+void AVLTree<Key, Value>::build_parallel(InputIt first, InputIt last, unsigned threads)
+{
+		bool threaded = this->threaded_;
+		this->clear();
+		this->threaded_ = false;
+
+		std::vector<std::pair<Key, Value> > items(first, last);
+		TaskPool pool(threads);
+		parallelStableSort(items, [](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) {
+			return a.first < b.first;
+		}, pool);
+
+		size_t count = 0;
+		for(size_t i = 0; i < items.size(); i++)
+		{
+			if(count > 0 && !(items[count - 1].first < items[i].first))
+				items[count - 1].second = items[i].second; //later duplicate wins
+			else
+				items[count++] = items[i];
+		}
+		items.resize(count);
+
+		buildRange(items.data(), 0, count, NULL, false, parallelSplitDepth(pool.threads()), &pool);
+		pool.wait();
+		refreshTree(static_cast<AVLNode<Key, Value>*>(this->root_));
+
+		this->size_ = count;
+		if(count > 0)
+		{
+			this->minNode_ = this->root_;
+			while(this->minNode_->getLeft() != NULL)
+				this->minNode_ = this->minNode_->getLeft();
+			this->maxNode_ = this->root_;
+			while(this->maxNode_->getRight() != NULL)
+				this->maxNode_ = this->maxNode_->getRight();
+		}
+		if(threaded)
+			this->setThreaded(true);
+}
+
+/*
+ * Builds the subtree over items [lo, hi) with the middle item on top and
+ * links it under parent. Above forkDepth the two halves become tasks.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::buildRange(const std::pair<Key, Value>* items, size_t lo, size_t hi,
+	AVLNode<Key,Value>* parent, bool asLeft, int forkDepth, TaskPool* pool)
+{
+		if(lo >= hi)
+			return;
+		size_t mid = lo + (hi - lo) / 2;
+		AVLNode<Key, Value>* n = createNode(items[mid].first, items[mid].second, parent);
+		n->setBalance(rangeHeight(hi - mid - 1) - rangeHeight(mid - lo));
+		if(parent == NULL)
+			this->root_ = n;
+		else if(asLeft)
+			parent->setLeft(n);
+		else
+			parent->setRight(n);
+
+		if(forkDepth > 0)
+		{
+			pool->submit([this, items, lo, mid, n, forkDepth, pool]() {
+				buildRange(items, lo, mid, n, true, forkDepth - 1, pool);
+			});
+			pool->submit([this, items, mid, hi, n, forkDepth, pool]() {
+				buildRange(items, mid + 1, hi, n, false, forkDepth - 1, pool);
+			});
+		}
+		else
+		{
+			buildRange(items, lo, mid, n, true, 0, pool);
+			buildRange(items, mid + 1, hi, n, false, 0, pool);
+		}
+}
+
+/*
+ * Height of a perfectly balanced tree of count nodes.
+ */
+template<class Key, class Value>
+int AVLTree<Key, Value>::rangeHeight(size_t count)
+{
+		int height = 0;
+		while(count > 0)
+		{
+			height++;
+			count >>= 1;
+		}
+		return height;
+}
+
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent)
+{
+		return new AVLNode<Key, Value>(key, value, parent);
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::refresh(AVLNode<Key, Value>*)
+{
 }
 
+/*
+ * Refreshes n and every ancestor of n.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::refreshPath(AVLNode<Key, Value>* n)
+{
+		if(!augmented_)
+			return;
+		for(; n != NULL; n = n->getParent())
+			refresh(n);
+}
 
+/*
+ * Refreshes every node under n, children first.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::refreshTree(AVLNode<Key, Value>* n)
+{
+		if(!augmented_ || n == NULL)
+			return;
+		refreshTree(n->getLeft());
+		refreshTree(n->getRight());
+		refresh(n);
+}
 
+/*
+ * Sets the balance of every node under n; returns the height of n
+ * (0 for NULL).
+ */
+template<class Key, class Value>
+int AVLTree<Key, Value>::resetBalances(AVLNode<Key, Value>* n)
+{
+		if(n == NULL)
+			return 0;
+		int left = resetBalances(n->getLeft());
+		int right = resetBalances(n->getRight());
+		n->setBalance(right - left);
+		return 1 + std::max(left, right);
+}
 
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::predecessor(AVLNode<Key, Value>* current)
+{
+    return static_cast<AVLNode<Key, Value>*>(BinarySearchTree<Key, Value>::predecessor(current));
+}
 
 /*
  * Recall: If key is already in the tree, you should 
@@ -588,92 +951,69 @@ AVLNode<Key, Value>* AVLTree<Key, Value>::predecessor(AVLNode<Key, Value>* curre
 template<class Key, class Value>
 void AVLTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item)
 {
-  Key key = new_item.first;
-  AVLNode<Key, Value>* next = internalFind(key);
-
-	if(next != NULL)
-		next->setValue(new_item.second);
+	Node<Key, Value>* parent = NULL;
+	bool asLeft = false;
+	Node<Key, Value>* existing = this->findSlot(new_item.first, parent, asLeft);
+	if(existing != NULL)
+		overwrite(existing, new_item.second);
 	else
+		linkNew(parent, asLeft, new_item);
+}
+
+/*
+ * Overwrites the value, bringing a lazily removed node back to life.
+ */
+template<class Key, class Value>
+void AVLTree<Key, Value>::overwrite(Node<Key, Value>* n, const Value& value)
+{
+	AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(n);
+	node->setValue(value);
+	if(node->isTombstone())
 	{
-		//dynamically allocate a new Node with inputted key/value
-		AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
-		//cout << "adding key " << key << endl;
-		if(this->root_ == NULL){
-			//cout << "root is null, adding node and returning" << endl;
-			this->root_ = newNode;
-      static_cast<AVLNode<Key, Value>*>(this->root_)->setBalance(0);
-			return;
-		}
-		//start at the top of the tree
-        else{
-            next = static_cast<AVLNode<Key, Value>*>(this->root_);
-            while(next != NULL)
-            {
-                if(key > next->getKey()) //go to the right
-                {
-									//cout << "going right" << endl;
-                    //cout << "at node " << next->getKey() << ", going right" << endl;
-                    if(next->getRight() == NULL) //if there's an empty spot
-                    {
-                        newNode->setParent(next);
-                        next->setRight(newNode);
-												//cout << "there's an empty spot" << endl;
-												//this->BinarySearchTree<Key,Value>::printRoot(this->root_);
-                        break;
-                    }
-                    next = next->getRight();
-                }
-                else //go to the left
-                {
-										//cout << "going left" << endl;
-                    //cout << "at node " << next->getValue() << ", going left" << endl;
-                    if(next->getLeft() == NULL) //if there's an empty spot
-                    {
-                        //cout << "theres an empty spot" << endl;
-                        newNode->setParent(next);
-                        next->setLeft(newNode);
-                        break;
-                    }
-                    next = next->getLeft();
-                }
-            }
-						//cout << "inserted node, now setting balance and fixing" << endl;
-            newNode->setBalance(0);
-						//cout << "do i make it here?" << endl;
-						//cout << "value of n is " << newNode->getValue() << endl;
-
-						
-            if(newNode->getParent()->getBalance() == -1 || newNode->getParent()->getBalance() == 1){
-                //cout << "balance of parent is " << next->getParent()->getBalance() << endl;
-								newNode->getParent()->setBalance(0);
-								//cout << "balance of parent set at 0" << endl;
-								//this->BinarySearchTree<Key,Value>::printRoot(this->root_);
-								//cout << "balance of newNode parent is finally " << newNode->getParent()->getBalance();
-								//cout << "pt 2: value of n is " << newNode->getValue() << endl;
-                return;
-            }
-            else if(newNode->getParent()->getLeft() == newNode){ //n is a left child & balance was 0
-                //cout << "n is a left child " << endl;
-								newNode->getParent()->setBalance( int(newNode->getParent()->getBalance()) - 1);
-								//cout << "pt 2: value of n is " << newNode->getValue() << endl;
-							//	cout << "balance of parent now  " << int(newNode->getParent()->getBalance()) << endl;
-                insertFix(newNode, newNode->getParent());
-								//cout << "pt 3: value of n is " << newNode->getValue() << endl;
-								//cout << "balance of newNode parent is finally " << newNode->getParent()->getBalance();
-            } //n is a right child & balance was 0
-            else{
-								//cout << "n is a right child " << endl;
-                newNode->getParent()->setBalance( int(newNode->getParent()->getBalance()) + 1);  
-								//cout << "pt 2: value of n is " << newNode->getValue() << endl;
-								//cout << "balance of parent now " << int(newNode->getParent()->getBalance()) << endl;
-                insertFix(newNode, newNode->getParent());
-								//cout << "pt 3: value of n is " << newNode->getValue() << endl;
-								//cout << "balance of newNode parent is finally " << newNode->getParent()->getBalance();
-            }
-
-						//this->BinarySearchTree<Key,Value>::printRoot(this->root_);
-        }
-	} 
+		node->setTombstone(false);
+		tombstones_--;
+		this->size_++;
+	}
+	refreshPath(node);
+}
+
+/*
+ * Links a new AVLNode into an empty slot and rebalances up from it.
+ */
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::linkNew(Node<Key, Value>* parent, bool asLeft,
+	const std::pair<const Key, Value> &new_item)
+{
+	AVLNode<Key, Value>* p = static_cast<AVLNode<Key, Value>*>(parent);
+	//dynamically allocate a new Node with inputted key/value
+	AVLNode<Key, Value>* newNode = createNode(new_item.first, new_item.second, p);
+	this->size_++;
+	this->cacheExtremes(newNode);
+	if(this->threaded_)
+		this->threadLeaf(newNode, p, asLeft);
+	if(p == NULL){
+		this->root_ = newNode;
+		refreshPath(newNode);
+		return newNode;
+	}
+	if(asLeft)
+		p->setLeft(newNode);
+	else
+		p->setRight(newNode);
+	refreshPath(newNode);
+
+	if(p->getBalance() == -1 || p->getBalance() == 1){
+		p->setBalance(0);
+	}
+	else if(asLeft){ //n is a left child & balance was 0
+		p->setBalance(-1);
+		insertFix(newNode, p);
+	}
+	else{ //n is a right child & balance was 0
+		p->setBalance(1);
+		insertFix(newNode, p);
+	}
+	return newNode;
 }
 
 template<class Key, class Value>
@@ -0,0 +1,1228 @@
+#ifndef AVLCOMPACT_H
+#define AVLCOMPACT_H
+
+#include <vector>
+#include <utility>
+#include <new>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* The two child links of an index-linked node (CompactNode, and the link
+* array of SplitNodes). Children are 31-bit indices, and the balance is
+* packed into the top bit of each link: the left link's top bit means
+* "left subtree taller" (balance -1), the right link's means "right
+* subtree taller" (balance 1). 8 bytes in all.
+*/
+class IndexLinks
+{
+public:
+    static const uint32_t NIL = 0x7fffffff;     // no child; also the index limit
+
+    IndexLinks();
+
+    uint32_t getLeft() const;
+    uint32_t getRight() const;
+    void setLeft(uint32_t left);        // keeps the balance bits
+    void setRight(uint32_t right);
+
+    int getBalance() const;
+    void setBalance(int balance);       // -1, 0 or 1
+
+protected:
+    static const uint32_t TALL = 0x80000000;
+
+    uint32_t left_;
+    uint32_t right_;
+};
+
+inline IndexLinks::IndexLinks() : left_(NIL), right_(NIL)
+{
+
+}
+
+inline uint32_t IndexLinks::getLeft() const
+{
+    return left_ & NIL;
+}
+
+inline uint32_t IndexLinks::getRight() const
+{
+    return right_ & NIL;
+}
+
+inline void IndexLinks::setLeft(uint32_t left)
+{
+    left_ = (left_ & TALL) | left;
+}
+
+inline void IndexLinks::setRight(uint32_t right)
+{
+    right_ = (right_ & TALL) | right;
+}
+
+inline int IndexLinks::getBalance() const
+{
+    return int(right_ >> 31) - int(left_ >> 31);
+}
+
+inline void IndexLinks::setBalance(int balance)
+{
+    left_ = getLeft() | (balance < 0 ? uint32_t(TALL) : 0);
+    right_ = getRight() | (balance > 0 ? uint32_t(TALL) : 0);
+}
+
+/**
+* A node of CompactAVLTree's default IndexedNodes storage: the item and
+* IndexLinks. There is no parent link and no vtable, so for uint64_t keys
+* and values a node is 24 bytes where AVLNode is 56.
+*/
+template <class Key, class Value>
+class CompactNode : public IndexLinks
+{
+public:
+    CompactNode(const Key& key, const Value& value);
+
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value& value);
+    std::pair<const Key, Value>& getItem();
+
+    // Moves other's item (and with take, its links) into this node
+    void takeItem(CompactNode& other);
+    void take(CompactNode& other);
+
+protected:
+    std::pair<const Key, Value> item_;
+};
+
+template<class Key, class Value>
+CompactNode<Key, Value>::CompactNode(const Key& key, const Value& value) :
+    item_(key, value)
+{
+
+}
+
+template<class Key, class Value>
+const Key& CompactNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<class Key, class Value>
+const Value& CompactNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<class Key, class Value>
+Value& CompactNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<class Key, class Value>
+void CompactNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& CompactNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+// The key is const, so the pair is rebuilt in place rather than assigned
+template<class Key, class Value>
+void CompactNode<Key, Value>::takeItem(CompactNode& other)
+{
+    item_.~pair();
+    new (&item_) std::pair<const Key, Value>(std::move(other.item_));
+}
+
+template<class Key, class Value>
+void CompactNode<Key, Value>::take(CompactNode& other)
+{
+    takeItem(other);
+    IndexLinks::operator=(other);
+}
+
+/**
+* A heap node for CompactAVLTree's LinkedNodes storage: AVLNode without
+* the parent link, the vtable and the separate balance byte. The balance
+* is packed into the low bit of each child pointer (nodes are at least
+* 8-byte aligned), the same trick threaded mode uses for its threads. For
+* uint64_t keys and values a node is 32 bytes where AVLNode is 56.
+*/
+template <class Key, class Value>
+class LinkedNode
+{
+public:
+    LinkedNode(const Key& key, const Value& value);
+
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value& value);
+    std::pair<const Key, Value>& getItem();
+
+    LinkedNode<Key, Value>* getLeft() const;
+    LinkedNode<Key, Value>* getRight() const;
+    void setLeft(LinkedNode<Key, Value>* left);     // keeps the balance bits
+    void setRight(LinkedNode<Key, Value>* right);
+
+    int getBalance() const;
+    void setBalance(int balance);       // -1, 0 or 1
+
+    void takeItem(LinkedNode& other);
+
+protected:
+    static const uintptr_t TALL = 1;
+
+    std::pair<const Key, Value> item_;
+    uintptr_t left_;
+    uintptr_t right_;
+};
+
+template<class Key, class Value>
+const uintptr_t LinkedNode<Key, Value>::TALL;
+
+template<class Key, class Value>
+LinkedNode<Key, Value>::LinkedNode(const Key& key, const Value& value) :
+    item_(key, value), left_(0), right_(0)
+{
+
+}
+
+template<class Key, class Value>
+const Key& LinkedNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<class Key, class Value>
+const Value& LinkedNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<class Key, class Value>
+Value& LinkedNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<class Key, class Value>
+void LinkedNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& LinkedNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<class Key, class Value>
+LinkedNode<Key, Value>* LinkedNode<Key, Value>::getLeft() const
+{
+    return reinterpret_cast<LinkedNode<Key, Value>*>(left_ & ~TALL);
+}
+
+template<class Key, class Value>
+LinkedNode<Key, Value>* LinkedNode<Key, Value>::getRight() const
+{
+    return reinterpret_cast<LinkedNode<Key, Value>*>(right_ & ~TALL);
+}
+
+template<class Key, class Value>
+void LinkedNode<Key, Value>::setLeft(LinkedNode<Key, Value>* left)
+{
+    left_ = (left_ & TALL) | reinterpret_cast<uintptr_t>(left);
+}
+
+template<class Key, class Value>
+void LinkedNode<Key, Value>::setRight(LinkedNode<Key, Value>* right)
+{
+    right_ = (right_ & TALL) | reinterpret_cast<uintptr_t>(right);
+}
+
+template<class Key, class Value>
+int LinkedNode<Key, Value>::getBalance() const
+{
+    return int(right_ & TALL) - int(left_ & TALL);
+}
+
+template<class Key, class Value>
+void LinkedNode<Key, Value>::setBalance(int balance)
+{
+    left_ = (left_ & ~TALL) | (balance < 0 ? TALL : 0);
+    right_ = (right_ & ~TALL) | (balance > 0 ? TALL : 0);
+}
+
+template<class Key, class Value>
+void LinkedNode<Key, Value>::takeItem(LinkedNode& other)
+{
+    item_.~pair();
+    new (&item_) std::pair<const Key, Value>(std::move(other.item_));
+}
+
+/**
+* Storage policies for CompactAVLTree. A policy owns the nodes and names
+* them by a Handle:
+*   Ref node(Handle);                   the node behind a handle (Node&,
+*                                       or a proxy with the same members)
+*   Reference item(Handle);             what the iterator's * returns
+*   Pointer pointer(Handle);            what the iterator's -> returns
+*   static Handle nil();                "no node"
+*   Handle allocate(key, value);
+*   Handle release(Handle h);           frees h; if another node moved
+*                                       into h's place, returns its old handle
+*   void clear(Handle root);  void reserve(size_t);  size_t size() const;
+*
+* IndexedNodes keeps the nodes packed at the front of one vector and
+* names them by 31-bit index. Removing moves the last node into the hole.
+*/
+template <class Key, class Value>
+class IndexedNodes
+{
+public:
+    typedef CompactNode<Key, Value> Node;
+    typedef uint32_t Handle;
+    typedef Node& Ref;
+    typedef const Node& ConstRef;
+    typedef std::pair<const Key, Value>& Reference;
+    typedef std::pair<const Key, Value>* Pointer;
+
+    Node& node(Handle h);
+    const Node& node(Handle h) const;
+    Reference item(Handle h);
+    Pointer pointer(Handle h);
+    static Handle nil();
+    Handle allocate(const Key& key, const Value& value);
+    Handle release(Handle h);
+    void clear(Handle root);
+    void reserve(size_t n);
+    size_t size() const;
+
+protected:
+    std::vector<Node> nodes_;
+};
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Node& IndexedNodes<Key, Value>::node(Handle h)
+{
+    return nodes_[h];
+}
+
+template<class Key, class Value>
+const typename IndexedNodes<Key, Value>::Node& IndexedNodes<Key, Value>::node(Handle h) const
+{
+    return nodes_[h];
+}
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Reference IndexedNodes<Key, Value>::item(Handle h)
+{
+    return nodes_[h].getItem();
+}
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Pointer IndexedNodes<Key, Value>::pointer(Handle h)
+{
+    return &nodes_[h].getItem();
+}
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Handle IndexedNodes<Key, Value>::nil()
+{
+    return Node::NIL;
+}
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Handle IndexedNodes<Key, Value>::allocate(const Key& key, const Value& value)
+{
+    if(nodes_.size() >= Node::NIL)
+        throw std::length_error("CompactAVLTree is full");
+    nodes_.push_back(Node(key, value));
+    return Handle(nodes_.size() - 1);
+}
+
+template<class Key, class Value>
+typename IndexedNodes<Key, Value>::Handle IndexedNodes<Key, Value>::release(Handle h)
+{
+    Handle last = Handle(nodes_.size() - 1);
+    if(h != last)
+        nodes_[h].take(nodes_[last]);
+    nodes_.pop_back();
+    return h != last ? last : nil();
+}
+
+template<class Key, class Value>
+void IndexedNodes<Key, Value>::clear(Handle)
+{
+    nodes_.clear();
+}
+
+template<class Key, class Value>
+void IndexedNodes<Key, Value>::reserve(size_t n)
+{
+    nodes_.reserve(n);
+}
+
+template<class Key, class Value>
+size_t IndexedNodes<Key, Value>::size() const
+{
+    return nodes_.size();
+}
+
+/**
+* LinkedNodes allocates every node on the heap and names it by pointer,
+* like AVLTree but without parent links. Nodes never move, and the tree
+* can't be copied.
+*/
+template <class Key, class Value>
+class LinkedNodes
+{
+public:
+    typedef LinkedNode<Key, Value> Node;
+    typedef LinkedNode<Key, Value>* Handle;
+    typedef Node& Ref;
+    typedef const Node& ConstRef;
+    typedef std::pair<const Key, Value>& Reference;
+    typedef std::pair<const Key, Value>* Pointer;
+
+    LinkedNodes();
+
+    Node& node(Handle h);
+    const Node& node(Handle h) const;
+    Reference item(Handle h);
+    Pointer pointer(Handle h);
+    static Handle nil();
+    Handle allocate(const Key& key, const Value& value);
+    Handle release(Handle h);
+    void clear(Handle root);
+    void reserve(size_t n);
+    size_t size() const;
+
+protected:
+    size_t size_;
+
+private:
+    LinkedNodes(const LinkedNodes&) = delete;
+    LinkedNodes& operator=(const LinkedNodes&) = delete;
+};
+
+template<class Key, class Value>
+LinkedNodes<Key, Value>::LinkedNodes() : size_(0)
+{
+
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Node& LinkedNodes<Key, Value>::node(Handle h)
+{
+    return *h;
+}
+
+template<class Key, class Value>
+const typename LinkedNodes<Key, Value>::Node& LinkedNodes<Key, Value>::node(Handle h) const
+{
+    return *h;
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Reference LinkedNodes<Key, Value>::item(Handle h)
+{
+    return h->getItem();
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Pointer LinkedNodes<Key, Value>::pointer(Handle h)
+{
+    return &h->getItem();
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Handle LinkedNodes<Key, Value>::nil()
+{
+    return NULL;
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Handle LinkedNodes<Key, Value>::allocate(const Key& key, const Value& value)
+{
+    Handle h = new Node(key, value);
+    size_++;
+    return h;
+}
+
+template<class Key, class Value>
+typename LinkedNodes<Key, Value>::Handle LinkedNodes<Key, Value>::release(Handle h)
+{
+    delete h;
+    size_--;
+    return NULL;
+}
+
+// Frees the tree at root with an explicit stack (the nodes can't reach
+// their parents, so a plain walk would need one anyway)
+template<class Key, class Value>
+void LinkedNodes<Key, Value>::clear(Handle root)
+{
+    std::vector<Handle> stack;
+    if(root != NULL)
+        stack.push_back(root);
+    while(!stack.empty())
+    {
+        Handle n = stack.back();
+        stack.pop_back();
+        if(n->getLeft() != NULL)
+            stack.push_back(n->getLeft());
+        if(n->getRight() != NULL)
+            stack.push_back(n->getRight());
+        delete n;
+    }
+    size_ = 0;
+}
+
+template<class Key, class Value>
+void LinkedNodes<Key, Value>::reserve(size_t)
+{
+
+}
+
+template<class Key, class Value>
+size_t LinkedNodes<Key, Value>::size() const
+{
+    return size_;
+}
+
+/**
+* SplitNodes stores the nodes as a structure of arrays: keys, links and
+* values each in their own vector, indexed (and compacted on remove) like
+* IndexedNodes. Descents (find, lower_bound, insert, remove) and scans
+* that only read it->first touch nothing but the key and link arrays, so
+* large values never pass through the cache until asked for.
+*
+* Since there is no stored pair, node() returns a proxy and the iterator
+* yields a std::pair of references (it->first, it->second work as usual).
+*/
+template <class Key, class Value>
+class SplitNodes
+{
+public:
+    typedef uint32_t Handle;
+
+    // Stands in for a node: the same members as CompactNode, reading and
+    // writing the three arrays at one index
+    class Ref
+    {
+    public:
+        Ref(SplitNodes<Key, Value>* nodes, Handle h);
+
+        const Key& getKey() const;
+        Value& getValue() const;
+        void setValue(const Value& value) const;
+
+        uint32_t getLeft() const;
+        uint32_t getRight() const;
+        void setLeft(uint32_t left) const;
+        void setRight(uint32_t right) const;
+        int getBalance() const;
+        void setBalance(int balance) const;
+
+        void takeItem(const Ref& other) const;
+
+    protected:
+        SplitNodes<Key, Value>* nodes_;
+        Handle h_;
+    };
+    typedef Ref ConstRef;
+    typedef std::pair<const Key&, Value&> Reference;
+
+    // Holds a Reference so that it-> can return its address
+    class Pointer
+    {
+    public:
+        Pointer(const Reference& item);
+        const Reference* operator->() const;
+
+    protected:
+        Reference item_;
+    };
+
+    Ref node(Handle h);
+    ConstRef node(Handle h) const;
+    Reference item(Handle h);
+    Pointer pointer(Handle h);
+    static Handle nil();
+    Handle allocate(const Key& key, const Value& value);
+    Handle release(Handle h);
+    void clear(Handle root);
+    void reserve(size_t n);
+    size_t size() const;
+
+protected:
+    std::vector<Key> keys_;
+    std::vector<IndexLinks> links_;
+    std::vector<Value> values_;
+};
+
+template<class Key, class Value>
+SplitNodes<Key, Value>::Ref::Ref(SplitNodes<Key, Value>* nodes, Handle h) : nodes_(nodes), h_(h)
+{
+
+}
+
+template<class Key, class Value>
+const Key& SplitNodes<Key, Value>::Ref::getKey() const
+{
+    return nodes_->keys_[h_];
+}
+
+template<class Key, class Value>
+Value& SplitNodes<Key, Value>::Ref::getValue() const
+{
+    return nodes_->values_[h_];
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::Ref::setValue(const Value& value) const
+{
+    nodes_->values_[h_] = value;
+}
+
+template<class Key, class Value>
+uint32_t SplitNodes<Key, Value>::Ref::getLeft() const
+{
+    return nodes_->links_[h_].getLeft();
+}
+
+template<class Key, class Value>
+uint32_t SplitNodes<Key, Value>::Ref::getRight() const
+{
+    return nodes_->links_[h_].getRight();
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::Ref::setLeft(uint32_t left) const
+{
+    nodes_->links_[h_].setLeft(left);
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::Ref::setRight(uint32_t right) const
+{
+    nodes_->links_[h_].setRight(right);
+}
+
+template<class Key, class Value>
+int SplitNodes<Key, Value>::Ref::getBalance() const
+{
+    return nodes_->links_[h_].getBalance();
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::Ref::setBalance(int balance) const
+{
+    nodes_->links_[h_].setBalance(balance);
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::Ref::takeItem(const Ref& other) const
+{
+    nodes_->keys_[h_] = std::move(nodes_->keys_[other.h_]);
+    nodes_->values_[h_] = std::move(nodes_->values_[other.h_]);
+}
+
+template<class Key, class Value>
+SplitNodes<Key, Value>::Pointer::Pointer(const Reference& item) : item_(item)
+{
+
+}
+
+template<class Key, class Value>
+const typename SplitNodes<Key, Value>::Reference* SplitNodes<Key, Value>::Pointer::operator->() const
+{
+    return &item_;
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Ref SplitNodes<Key, Value>::node(Handle h)
+{
+    return Ref(this, h);
+}
+
+// The proxy has no const flavour; const trees only call its getters
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::ConstRef SplitNodes<Key, Value>::node(Handle h) const
+{
+    return Ref(const_cast<SplitNodes<Key, Value>*>(this), h);
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Reference SplitNodes<Key, Value>::item(Handle h)
+{
+    return Reference(keys_[h], values_[h]);
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Pointer SplitNodes<Key, Value>::pointer(Handle h)
+{
+    return Pointer(item(h));
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Handle SplitNodes<Key, Value>::nil()
+{
+    return IndexLinks::NIL;
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Handle SplitNodes<Key, Value>::allocate(const Key& key, const Value& value)
+{
+    if(keys_.size() >= IndexLinks::NIL)
+        throw std::length_error("CompactAVLTree is full");
+    keys_.push_back(key);
+    links_.push_back(IndexLinks());
+    values_.push_back(value);
+    return Handle(keys_.size() - 1);
+}
+
+template<class Key, class Value>
+typename SplitNodes<Key, Value>::Handle SplitNodes<Key, Value>::release(Handle h)
+{
+    Handle last = Handle(keys_.size() - 1);
+    if(h != last)
+    {
+        keys_[h] = std::move(keys_[last]);
+        links_[h] = links_[last];
+        values_[h] = std::move(values_[last]);
+    }
+    keys_.pop_back();
+    links_.pop_back();
+    values_.pop_back();
+    return h != last ? last : nil();
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::clear(Handle)
+{
+    keys_.clear();
+    links_.clear();
+    values_.clear();
+}
+
+template<class Key, class Value>
+void SplitNodes<Key, Value>::reserve(size_t n)
+{
+    keys_.reserve(n);
+    links_.reserve(n);
+    values_.reserve(n);
+}
+
+template<class Key, class Value>
+size_t SplitNodes<Key, Value>::size() const
+{
+    return keys_.size();
+}
+
+/**
+* An AVL tree without parent links. insert and remove record their path
+* from the root in a fixed array (an AVL tree of 2^31 nodes is at most 45
+* levels tall) and retrace it, and the iterator keeps its own stack, so
+* no node ever needs to reach its parent. Any insert or remove
+* invalidates all iterators.
+*
+* The Storage policy decides what a link is:
+* - IndexedNodes (the default) keeps the nodes in one std::vector linked
+*   by 32-bit indices, for trees of fewer than 2^31 - 1 items. The nodes
+*   stay dense and cache friendly, copying the tree is a single vector
+*   copy, and for trivially copyable keys and values the node array can
+*   be memcpy'd or written out as is (indices don't change when it moves).
+* - LinkedNodes keeps AVLTree's one heap node per item, linked by pointers.
+* - SplitNodes is IndexedNodes with keys, links and values in separate
+*   arrays, for scans and lookups that don't read the (large) values.
+*/
+template <class Key, class Value, class Storage = IndexedNodes<Key, Value> >
+class CompactAVLTree
+{
+public:
+    typedef typename Storage::Handle Handle;
+    static const int MAX_HEIGHT = 48;
+
+    CompactAVLTree();
+    ~CompactAVLTree();
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        typename Storage::Reference operator*() const;
+        typename Storage::Pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value, Storage>;
+        iterator(Storage* nodes);
+        void pushLeftmost(Handle n);
+
+        Storage* nodes_;
+        Handle path_[MAX_HEIGHT];       // the current node and the ancestors still to visit
+        int depth_;                     // 0 for end()
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;    // first item whose key is not less than key
+    bool contains(const Key& key) const;
+    Value& at(const Key& key);
+    Value const & at(const Key& key) const;
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    void reserve(size_t n);
+    size_t size() const;
+    bool empty() const;
+
+protected:
+    typename Storage::Ref node(Handle h);
+    typename Storage::ConstRef node(Handle h) const;
+    static Handle nil();
+    Handle findHandle(const Key& key) const;
+    Handle rotateLeft(Handle n);
+    Handle rotateRight(Handle n);
+    Handle rebalanceAt(Handle n, bool rightTall);
+    void link(Handle parent, bool asLeft, Handle child);
+    void release(Handle victim);
+
+    Storage nodes_;
+    Handle root_;
+};
+
+template<class Key, class Value, class Storage>
+const int CompactAVLTree<Key, Value, Storage>::MAX_HEIGHT;
+
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::iterator::iterator() : nodes_(NULL), depth_(0)
+{
+
+}
+
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::iterator::iterator(Storage* nodes) : nodes_(nodes), depth_(0)
+{
+
+}
+
+template<class Key, class Value, class Storage>
+typename Storage::Reference CompactAVLTree<Key, Value, Storage>::iterator::operator*() const
+{
+    return nodes_->item(path_[depth_ - 1]);
+}
+
+template<class Key, class Value, class Storage>
+typename Storage::Pointer CompactAVLTree<Key, Value, Storage>::iterator::operator->() const
+{
+    return nodes_->pointer(path_[depth_ - 1]);
+}
+
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::iterator::operator==(const iterator& rhs) const
+{
+    if(depth_ == 0 || rhs.depth_ == 0)
+        return depth_ == rhs.depth_;
+    return path_[depth_ - 1] == rhs.path_[rhs.depth_ - 1];
+}
+
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::iterator::pushLeftmost(Handle n)
+{
+    for(; n != Storage::nil(); n = nodes_->node(n).getLeft())
+        path_[depth_++] = n;
+}
+
+/**
+* The next node is the leftmost of the right subtree if there is one,
+* otherwise the nearest ancestor we descended left from, which is the
+* next entry on the stack.
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator& CompactAVLTree<Key, Value, Storage>::iterator::operator++()
+{
+    Handle n = path_[--depth_];
+    pushLeftmost(nodes_->node(n).getRight());
+    return *this;
+}
+
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::CompactAVLTree() : root_(Storage::nil())
+{
+
+}
+
+template<class Key, class Value, class Storage>
+CompactAVLTree<Key, Value, Storage>::~CompactAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Storage>
+typename Storage::Ref CompactAVLTree<Key, Value, Storage>::node(Handle h)
+{
+    return nodes_.node(h);
+}
+
+template<class Key, class Value, class Storage>
+typename Storage::ConstRef CompactAVLTree<Key, Value, Storage>::node(Handle h) const
+{
+    return nodes_.node(h);
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::Handle CompactAVLTree<Key, Value, Storage>::nil()
+{
+    return Storage::nil();
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator CompactAVLTree<Key, Value, Storage>::begin() const
+{
+    iterator it(const_cast<Storage*>(&nodes_));
+    it.pushLeftmost(root_);
+    return it;
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator CompactAVLTree<Key, Value, Storage>::end() const
+{
+    return iterator(const_cast<Storage*>(&nodes_));
+}
+
+/**
+* Descends from the root, stacking the nodes we go left from (they come
+* after the match in order), so the iterator can carry on from the match.
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator CompactAVLTree<Key, Value, Storage>::find(const Key& key) const
+{
+    iterator it(const_cast<Storage*>(&nodes_));
+    Handle n = root_;
+    while(n != nil())
+    {
+        typename Storage::ConstRef current = node(n);
+        if(key == current.getKey())
+        {
+            it.path_[it.depth_++] = n;
+            return it;
+        }
+        if(key < current.getKey())
+        {
+            it.path_[it.depth_++] = n;
+            n = current.getLeft();
+        }
+        else
+            n = current.getRight();
+    }
+    return end();
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::iterator CompactAVLTree<Key, Value, Storage>::lower_bound(const Key& key) const
+{
+    iterator it(const_cast<Storage*>(&nodes_));
+    for(Handle n = root_; n != nil(); )
+    {
+        if(node(n).getKey() < key)
+            n = node(n).getRight();
+        else
+        {
+            it.path_[it.depth_++] = n;
+            n = node(n).getLeft();
+        }
+    }
+    return it;
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::Handle CompactAVLTree<Key, Value, Storage>::findHandle(const Key& key) const
+{
+    Handle n = root_;
+    while(n != nil() && !(node(n).getKey() == key))
+        n = (key < node(n).getKey()) ? node(n).getLeft() : node(n).getRight();
+    return n;
+}
+
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::contains(const Key& key) const
+{
+    return findHandle(key) != nil();
+}
+
+template<class Key, class Value, class Storage>
+Value& CompactAVLTree<Key, Value, Storage>::at(const Key& key)
+{
+    Handle n = findHandle(key);
+    if(n == nil()) throw std::out_of_range("Invalid key");
+    return node(n).getValue();
+}
+
+template<class Key, class Value, class Storage>
+Value const & CompactAVLTree<Key, Value, Storage>::at(const Key& key) const
+{
+    Handle n = findHandle(key);
+    if(n == nil()) throw std::out_of_range("Invalid key");
+    return node(n).getValue();
+}
+
+template<class Key, class Value, class Storage>
+size_t CompactAVLTree<Key, Value, Storage>::size() const
+{
+    return nodes_.size();
+}
+
+template<class Key, class Value, class Storage>
+bool CompactAVLTree<Key, Value, Storage>::empty() const
+{
+    return root_ == nil();
+}
+
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::clear()
+{
+    nodes_.clear(root_);
+    root_ = nil();
+}
+
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::reserve(size_t n)
+{
+    nodes_.reserve(n);
+}
+
+// Points parent's left or right link (root_ if parent is nil) at child
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::link(Handle parent, bool asLeft, Handle child)
+{
+    if(parent == nil())
+        root_ = child;
+    else if(asLeft)
+        node(parent).setLeft(child);
+    else
+        node(parent).setRight(child);
+}
+
+// Rotations return the subtree's new root; the caller relinks it and
+// sets the balances
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::Handle CompactAVLTree<Key, Value, Storage>::rotateLeft(Handle n)
+{
+    Handle newParent = node(n).getRight();
+    node(n).setRight(node(newParent).getLeft());
+    node(newParent).setLeft(n);
+    return newParent;
+}
+
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::Handle CompactAVLTree<Key, Value, Storage>::rotateRight(Handle n)
+{
+    Handle newParent = node(n).getLeft();
+    node(n).setLeft(node(newParent).getRight());
+    node(newParent).setRight(n);
+    return newParent;
+}
+
+/**
+* Fixes n, whose right (rightTall) or left subtree is two levels taller
+* than the other; a balance of 2 doesn't fit in the link bits, so it is
+* passed in rather than stored. Returns the subtree's new root. After a
+* remove, the subtree kept its height only if that root's balance is not 0.
+*/
+template<class Key, class Value, class Storage>
+typename CompactAVLTree<Key, Value, Storage>::Handle CompactAVLTree<Key, Value, Storage>::rebalanceAt(Handle n, bool rightTall)
+{
+    if(rightTall)
+    {
+        Handle c = node(n).getRight();
+        int childBalance = node(c).getBalance();
+        if(childBalance < 0) //zig zag
+        {
+            Handle g = node(c).getLeft();
+            int grandBalance = node(g).getBalance();
+            node(n).setRight(rotateRight(c));
+            rotateLeft(n);
+            node(n).setBalance(grandBalance > 0 ? -1 : 0);
+            node(c).setBalance(grandBalance < 0 ? 1 : 0);
+            node(g).setBalance(0);
+            return g;
+        }
+        rotateLeft(n); //zig zig
+        node(n).setBalance(childBalance == 0 ? 1 : 0);
+        node(c).setBalance(childBalance == 0 ? -1 : 0);
+        return c;
+    }
+    Handle c = node(n).getLeft();
+    int childBalance = node(c).getBalance();
+    if(childBalance > 0) //zig zag
+    {
+        Handle g = node(c).getRight();
+        int grandBalance = node(g).getBalance();
+        node(n).setLeft(rotateLeft(c));
+        rotateRight(n);
+        node(n).setBalance(grandBalance < 0 ? 1 : 0);
+        node(c).setBalance(grandBalance > 0 ? -1 : 0);
+        node(g).setBalance(0);
+        return g;
+    }
+    rotateRight(n); //zig zig
+    node(n).setBalance(childBalance == 0 ? -1 : 0);
+    node(c).setBalance(childBalance == 0 ? 1 : 0);
+    return c;
+}
+
+/**
+* Recall: If key is already in the tree, you should
+* overwrite the current value with the updated value.
+* Otherwise a new leaf is linked in, and the path is retraced until a
+* subtree's height stops growing.
+*/
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Handle path[MAX_HEIGHT];
+    bool wentLeft[MAX_HEIGHT];
+    int depth = 0;
+    for(Handle n = root_; n != nil(); depth++)
+    {
+        typename Storage::Ref current = node(n);
+        if(keyValuePair.first == current.getKey())
+        {
+            current.setValue(keyValuePair.second);
+            return;
+        }
+        path[depth] = n;
+        wentLeft[depth] = keyValuePair.first < current.getKey();
+        n = wentLeft[depth] ? current.getLeft() : current.getRight();
+    }
+    Handle child = nodes_.allocate(keyValuePair.first, keyValuePair.second);
+    if(depth == 0)
+    {
+        root_ = child;
+        return;
+    }
+    link(path[depth - 1], wentLeft[depth - 1], child);
+
+    for(int i = depth - 1; i >= 0; i--)
+    {
+        int balance = node(path[i]).getBalance() + (wentLeft[i] ? -1 : 1);
+        if(balance == 2 || balance == -2)
+        {
+            Handle top = rebalanceAt(path[i], balance > 0);
+            link(i == 0 ? nil() : path[i - 1], i > 0 && wentLeft[i - 1], top);
+            return;
+        }
+        node(path[i]).setBalance(balance);
+        if(balance == 0)
+            return;
+    }
+}
+
+/**
+* A node with two children takes its predecessor's item, and the
+* predecessor's node is unlinked instead. The path is retraced until a
+* subtree keeps its height, then the node is released.
+*/
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::remove(const Key& key)
+{
+    Handle path[MAX_HEIGHT];
+    bool wentLeft[MAX_HEIGHT];
+    int depth = 0;
+    Handle n = root_;
+    while(n != nil() && !(node(n).getKey() == key))
+    {
+        path[depth] = n;
+        wentLeft[depth] = key < node(n).getKey();
+        n = wentLeft[depth] ? node(n).getLeft() : node(n).getRight();
+        depth++;
+    }
+    if(n == nil())
+        return;
+
+    Handle victim = n;
+    if(node(n).getLeft() != nil() && node(n).getRight() != nil())
+    {
+        path[depth] = n;
+        wentLeft[depth++] = true;
+        victim = node(n).getLeft();
+        while(node(victim).getRight() != nil())
+        {
+            path[depth] = victim;
+            wentLeft[depth++] = false;
+            victim = node(victim).getRight();
+        }
+        node(n).takeItem(node(victim));
+    }
+    Handle child = node(victim).getLeft() != nil() ? node(victim).getLeft() : node(victim).getRight();
+    link(depth == 0 ? nil() : path[depth - 1], depth > 0 && wentLeft[depth - 1], child);
+
+    for(int i = depth - 1; i >= 0; i--)
+    {
+        int balance = node(path[i]).getBalance() + (wentLeft[i] ? 1 : -1);
+        if(balance == 2 || balance == -2)
+        {
+            Handle top = rebalanceAt(path[i], balance > 0);
+            link(i == 0 ? nil() : path[i - 1], i > 0 && wentLeft[i - 1], top);
+            if(node(top).getBalance() != 0)
+                break;
+            continue;
+        }
+        node(path[i]).setBalance(balance);
+        if(balance != 0)
+            break;
+    }
+    release(victim);
+}
+
+/**
+* Frees an unlinked node. If the storage moved another node into its
+* place, the link to that node's old handle is found by searching for
+* its key and pointed at the new one.
+*/
+template<class Key, class Value, class Storage>
+void CompactAVLTree<Key, Value, Storage>::release(Handle victim)
+{
+    Handle moved = nodes_.release(victim);
+    if(moved == nil())
+        return;
+    const Key& key = node(victim).getKey();
+    Handle parent = nil();
+    bool asLeft = false;
+    for(Handle n = root_; n != moved; )
+    {
+        parent = n;
+        asLeft = key < node(n).getKey();
+        n = asLeft ? node(n).getLeft() : node(n).getRight();
+    }
+    link(parent, asLeft, victim);
+}
+
+#endif
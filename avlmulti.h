@@ -0,0 +1,180 @@
+#ifndef AVLMULTI_H
+#define AVLMULTI_H
+
+#include <utility>
+#include "avlbst.h"
+
+/**
+* An AVLTree that keeps duplicate keys, each as its own node. Equal keys
+* sit next to each other in insertion order: insert() sends a key equal
+* to a node's key to the right, so it lands after every copy already in
+* the tree. Rotations and removals never reorder nodes, so the order
+* holds for the life of the tree.
+*
+* find(), the bounds and equal_range() are O(log n) descents, and count()
+* walks the k copies after one, O(log n + k). at(), operator[], try_get() and get_or() still reach exactly
+* one of the copies, which one is unspecified. remove(key) removes every
+* copy and erase(it) only one. Removal is always eager, even with
+* setLazyDelete(true), and build_parallel() still keeps one item per key.
+*/
+template <class Key, class Value>
+class AVLMultiMap : public AVLTree<Key, Value>
+{
+public:
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    void erase(iterator it);
+
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+
+protected:
+    Node<Key, Value>* firstNotBefore(const Key& key) const;
+    Node<Key, Value>* firstAfter(const Key& key) const;
+};
+
+/**
+* Descends to the slot after the last copy of the key, or attaches to the
+* largest node right away when the key is not smaller than it.
+*/
+template<class Key, class Value>
+void AVLMultiMap<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+	Node<Key, Value>* parent = NULL;
+	bool asLeft = false;
+	if(this->root_ != NULL && !(new_item.first < this->maxNode_->getKey()))
+		parent = this->maxNode_; //append
+	else
+	{
+		for(Node<Key, Value>* n = this->root_; n != NULL; )
+		{
+			parent = n;
+			asLeft = new_item.first < n->getKey();
+			n = asLeft ? n->getLeft() : n->getRight();
+		}
+	}
+	Node<Key, Value>* newNode = this->linkNew(parent, asLeft, new_item);
+	//cacheExtremes keeps the first of equal largest keys, but maxNode_ has
+	//to be the last in order
+	if(!(new_item.first < this->maxNode_->getKey()))
+		this->maxNode_ = newNode;
+}
+
+template<class Key, class Value>
+void AVLMultiMap<Key, Value>::remove(const Key& key)
+{
+	Node<Key, Value>* n;
+	while((n = firstNotBefore(key)) != NULL && n->getKey() == key)
+		this->removeNode(n);
+}
+
+template<class Key, class Value>
+void AVLMultiMap<Key, Value>::erase(iterator it)
+{
+	Node<Key, Value>* n = this->nodeAt(it);
+	if(n != NULL)
+		this->removeNode(n);
+}
+
+/**
+* The first copy of key in insertion order, or end().
+*/
+template<class Key, class Value>
+typename AVLMultiMap<Key, Value>::iterator
+AVLMultiMap<Key, Value>::find(const Key& key) const
+{
+	Node<Key, Value>* n = firstNotBefore(key);
+	if(n != NULL && n->getKey() == key)
+		return this->iteratorAt(n);
+	return this->end();
+}
+
+template<class Key, class Value>
+size_t AVLMultiMap<Key, Value>::count(const Key& key) const
+{
+	size_t copies = 0;
+	for(Node<Key, Value>* n = firstNotBefore(key); n != NULL && n->getKey() == key; n = this->successor(n))
+		copies++;
+	return copies;
+}
+
+template<class Key, class Value>
+typename AVLMultiMap<Key, Value>::iterator
+AVLMultiMap<Key, Value>::lower_bound(const Key& key) const
+{
+	return this->iteratorAt(firstNotBefore(key));
+}
+
+template<class Key, class Value>
+typename AVLMultiMap<Key, Value>::iterator
+AVLMultiMap<Key, Value>::upper_bound(const Key& key) const
+{
+	return this->iteratorAt(firstAfter(key));
+}
+
+template<class Key, class Value>
+std::pair<typename AVLMultiMap<Key, Value>::iterator, typename AVLMultiMap<Key, Value>::iterator>
+AVLMultiMap<Key, Value>::equal_range(const Key& key) const
+{
+	return std::make_pair(this->iteratorAt(firstNotBefore(key)), this->iteratorAt(firstAfter(key)));
+}
+
+// Leftmost node whose key is not less than key (NULL if none)
+template<class Key, class Value>
+Node<Key, Value>* AVLMultiMap<Key, Value>::firstNotBefore(const Key& key) const
+{
+	Node<Key, Value>* found = NULL;
+	for(Node<Key, Value>* n = this->root_; n != NULL; )
+	{
+		if(n->getKey() < key)
+			n = n->getRight();
+		else
+		{
+			found = n;
+			n = n->getLeft();
+		}
+	}
+	return found;
+}
+
+// Leftmost node whose key is greater than key (NULL if none)
+template<class Key, class Value>
+Node<Key, Value>* AVLMultiMap<Key, Value>::firstAfter(const Key& key) const
+{
+	Node<Key, Value>* found = NULL;
+	for(Node<Key, Value>* n = this->root_; n != NULL; )
+	{
+		if(key < n->getKey())
+		{
+			found = n;
+			n = n->getLeft();
+		}
+		else
+			n = n->getRight();
+	}
+	return found;
+}
+
+/**
+* Keys only, duplicates allowed. The nodes still carry a one-byte value.
+*/
+template <class Key>
+class AVLMultiSet : public AVLMultiMap<Key, char>
+{
+public:
+    using AVLMultiMap<Key, char>::insert;
+    void insert(const Key& key);
+};
+
+template<class Key>
+void AVLMultiSet<Key>::insert(const Key& key)
+{
+	this->insert(std::make_pair(key, char()));
+}
+
+#endif
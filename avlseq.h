@@ -0,0 +1,506 @@
+#ifndef AVLSEQ_H
+#define AVLSEQ_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+/**
+* A node of an implicit-key AVL tree. There is no key: a node's position in
+* the sequence is the number of nodes before it in an in-order walk, which
+* is found from the subtree sizes on the way down.
+*
+* Instead of AVLNode's balance byte each node stores its height, because
+* joining two trees of very different heights (concat, split) has to
+* compare absolute heights.
+*/
+template <typename Value>
+class SeqNode
+{
+public:
+    SeqNode(const Value& value);
+
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value& value);
+
+    SeqNode<Value>* getLeft() const;
+    SeqNode<Value>* getRight() const;
+    void setLeft(SeqNode<Value>* left);
+    void setRight(SeqNode<Value>* right);
+
+    int8_t getHeight() const;
+    size_t getSize() const;
+    void update();      // recompute height and size from the children
+
+    static int8_t height(const SeqNode<Value>* n);
+    static size_t size(const SeqNode<Value>* n);
+
+protected:
+    Value value_;
+    SeqNode<Value>* left_;
+    SeqNode<Value>* right_;
+    size_t size_;       // number of nodes in this subtree
+    int8_t height_;     // a leaf has height 1
+};
+
+template<typename Value>
+SeqNode<Value>::SeqNode(const Value& value) :
+    value_(value), left_(NULL), right_(NULL), size_(1), height_(1)
+{
+
+}
+
+template<typename Value>
+const Value& SeqNode<Value>::getValue() const
+{
+    return value_;
+}
+
+template<typename Value>
+Value& SeqNode<Value>::getValue()
+{
+    return value_;
+}
+
+template<typename Value>
+void SeqNode<Value>::setValue(const Value& value)
+{
+    value_ = value;
+}
+
+template<typename Value>
+SeqNode<Value>* SeqNode<Value>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Value>
+SeqNode<Value>* SeqNode<Value>::getRight() const
+{
+    return right_;
+}
+
+template<typename Value>
+void SeqNode<Value>::setLeft(SeqNode<Value>* left)
+{
+    left_ = left;
+}
+
+template<typename Value>
+void SeqNode<Value>::setRight(SeqNode<Value>* right)
+{
+    right_ = right;
+}
+
+template<typename Value>
+int8_t SeqNode<Value>::getHeight() const
+{
+    return height_;
+}
+
+template<typename Value>
+size_t SeqNode<Value>::getSize() const
+{
+    return size_;
+}
+
+template<typename Value>
+void SeqNode<Value>::update()
+{
+    height_ = 1 + std::max(height(left_), height(right_));
+    size_ = 1 + size(left_) + size(right_);
+}
+
+template<typename Value>
+int8_t SeqNode<Value>::height(const SeqNode<Value>* n)
+{
+    return n == NULL ? 0 : n->height_;
+}
+
+template<typename Value>
+size_t SeqNode<Value>::size(const SeqNode<Value>* n)
+{
+    return n == NULL ? 0 : n->size_;
+}
+
+/**
+* A sequence (like a rope or std::vector) stored as an AVL tree ordered by
+* position. insert_at, erase_at, at, split_at and concat are all O(log n).
+*/
+template <typename Value>
+class AVLSequence
+{
+public:
+    AVLSequence();
+    ~AVLSequence();
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    Value& at(size_t i);
+    const Value& at(size_t i) const;
+    Value& operator[](size_t i);
+    const Value& operator[](size_t i) const;
+
+    void insert_at(size_t i, const Value& value);   // new item ends up at position i
+    void erase_at(size_t i);
+    void push_back(const Value& value);
+    void push_front(const Value& value);
+
+    // Moves the items at positions [i, size()) into rest, which must be empty
+    void split_at(size_t i, AVLSequence<Value>& rest);
+    // Appends all of other's items, leaving other empty
+    void concat(AVLSequence<Value>& other);
+
+protected:
+    typedef SeqNode<Value> N;
+
+    static N* rotateLeft(N* n);
+    static N* rotateRight(N* n);
+    static N* rebalance(N* n);
+    static N* join(N* left, N* mid, N* right);
+    static N* joinLeftHeavy(N* left, N* mid, N* right);
+    static N* joinRightHeavy(N* left, N* mid, N* right);
+    static void split(N* n, size_t i, N*& left, N*& right);
+    static N* insertHelper(N* n, size_t i, N* newNode);
+    static N* eraseHelper(N* n, size_t i, N*& erased);
+    static N* removeFirst(N* n, N*& first);
+    static void clearHelper(N* n);
+    N* nodeAt(size_t i) const;
+
+    N* root_;
+
+private:
+    AVLSequence(const AVLSequence&) = delete;
+    AVLSequence& operator=(const AVLSequence&) = delete;
+};
+
+template<typename Value>
+AVLSequence<Value>::AVLSequence() : root_(NULL)
+{
+
+}
+
+template<typename Value>
+AVLSequence<Value>::~AVLSequence()
+{
+    clear();
+}
+
+template<typename Value>
+size_t AVLSequence<Value>::size() const
+{
+    return N::size(root_);
+}
+
+template<typename Value>
+bool AVLSequence<Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<typename Value>
+void AVLSequence<Value>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+}
+
+template<typename Value>
+void AVLSequence<Value>::clearHelper(N* n)
+{
+    if(n == NULL)
+        return;
+    clearHelper(n->getLeft());
+    clearHelper(n->getRight());
+    delete n;
+}
+
+/**
+* Walks down comparing i with the size of the left subtree.
+*/
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::nodeAt(size_t i) const
+{
+    if(i >= size())
+        throw std::out_of_range("Invalid index");
+    N* n = root_;
+    while(true)
+    {
+        size_t leftSize = N::size(n->getLeft());
+        if(i < leftSize)
+            n = n->getLeft();
+        else if(i == leftSize)
+            return n;
+        else
+        {
+            i -= leftSize + 1;
+            n = n->getRight();
+        }
+    }
+}
+
+template<typename Value>
+Value& AVLSequence<Value>::at(size_t i)
+{
+    return nodeAt(i)->getValue();
+}
+
+template<typename Value>
+const Value& AVLSequence<Value>::at(size_t i) const
+{
+    return nodeAt(i)->getValue();
+}
+
+template<typename Value>
+Value& AVLSequence<Value>::operator[](size_t i)
+{
+    return nodeAt(i)->getValue();
+}
+
+template<typename Value>
+const Value& AVLSequence<Value>::operator[](size_t i) const
+{
+    return nodeAt(i)->getValue();
+}
+
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::rotateLeft(N* n)
+{
+    N* newParent = n->getRight();
+    n->setRight(newParent->getLeft());
+    newParent->setLeft(n);
+    n->update();
+    newParent->update();
+    return newParent;
+}
+
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::rotateRight(N* n)
+{
+    N* newParent = n->getLeft();
+    n->setLeft(newParent->getRight());
+    newParent->setRight(n);
+    n->update();
+    newParent->update();
+    return newParent;
+}
+
+/**
+* Fixes a node whose children differ in height by at most 2 (the zig zig
+* and zig zag cases of insertFix/removeFix) and returns the subtree's new root.
+*/
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::rebalance(N* n)
+{
+    n->update();
+    int balance = N::height(n->getRight()) - N::height(n->getLeft());
+    if(balance < -1)
+    {
+        N* c = n->getLeft();
+        if(N::height(c->getRight()) > N::height(c->getLeft())) //zig zag
+            n->setLeft(rotateLeft(c));
+        return rotateRight(n);
+    }
+    if(balance > 1)
+    {
+        N* c = n->getRight();
+        if(N::height(c->getLeft()) > N::height(c->getRight())) //zig zag
+            n->setRight(rotateRight(c));
+        return rotateLeft(n);
+    }
+    return n;
+}
+
+/**
+* Joins left, mid and right (in that order) into one balanced tree in
+* O(|height(left) - height(right)|): walk down the spine of the taller tree
+* until the heights match, hang mid there and rebalance back up.
+*/
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::join(N* left, N* mid, N* right)
+{
+    if(N::height(left) > N::height(right) + 1)
+        return joinLeftHeavy(left, mid, right);
+    if(N::height(right) > N::height(left) + 1)
+        return joinRightHeavy(left, mid, right);
+    mid->setLeft(left);
+    mid->setRight(right);
+    mid->update();
+    return mid;
+}
+
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::joinLeftHeavy(N* left, N* mid, N* right)
+{
+    if(N::height(left) <= N::height(right) + 1)
+    {
+        mid->setLeft(left);
+        mid->setRight(right);
+        mid->update();
+        return mid;
+    }
+    left->setRight(joinLeftHeavy(left->getRight(), mid, right));
+    return rebalance(left);
+}
+
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::joinRightHeavy(N* left, N* mid, N* right)
+{
+    if(N::height(right) <= N::height(left) + 1)
+    {
+        mid->setLeft(left);
+        mid->setRight(right);
+        mid->update();
+        return mid;
+    }
+    right->setLeft(joinRightHeavy(left, mid, right->getLeft()));
+    return rebalance(right);
+}
+
+/**
+* Splits the subtree at n into its first i items (left) and the rest (right).
+*/
+template<typename Value>
+void AVLSequence<Value>::split(N* n, size_t i, N*& left, N*& right)
+{
+    if(n == NULL)
+    {
+        left = right = NULL;
+        return;
+    }
+    N* l = n->getLeft();
+    N* r = n->getRight();
+    size_t leftSize = N::size(l);
+    if(i <= leftSize)
+    {
+        N* rest;
+        split(l, i, left, rest);
+        right = join(rest, n, r);
+    }
+    else
+    {
+        N* rest;
+        split(r, i - leftSize - 1, rest, right);
+        left = join(l, n, rest);
+    }
+}
+
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::insertHelper(N* n, size_t i, N* newNode)
+{
+    if(n == NULL)
+        return newNode;
+    size_t leftSize = N::size(n->getLeft());
+    if(i <= leftSize)
+        n->setLeft(insertHelper(n->getLeft(), i, newNode));
+    else
+        n->setRight(insertHelper(n->getRight(), i - leftSize - 1, newNode));
+    return rebalance(n);
+}
+
+template<typename Value>
+void AVLSequence<Value>::insert_at(size_t i, const Value& value)
+{
+    if(i > size())
+        throw std::out_of_range("Invalid index");
+    root_ = insertHelper(root_, i, new N(value));
+}
+
+template<typename Value>
+void AVLSequence<Value>::push_back(const Value& value)
+{
+    insert_at(size(), value);
+}
+
+template<typename Value>
+void AVLSequence<Value>::push_front(const Value& value)
+{
+    insert_at(0, value);
+}
+
+/**
+* Unlinks the first node of the subtree at n, returning the new subtree root.
+*/
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::removeFirst(N* n, N*& first)
+{
+    if(n->getLeft() == NULL)
+    {
+        first = n;
+        return n->getRight();
+    }
+    n->setLeft(removeFirst(n->getLeft(), first));
+    return rebalance(n);
+}
+
+/**
+* Unlinks the node at position i. A node with two children is replaced by
+* the first node of its right subtree.
+*/
+template<typename Value>
+typename AVLSequence<Value>::N* AVLSequence<Value>::eraseHelper(N* n, size_t i, N*& erased)
+{
+    size_t leftSize = N::size(n->getLeft());
+    if(i < leftSize)
+        n->setLeft(eraseHelper(n->getLeft(), i, erased));
+    else if(i > leftSize)
+        n->setRight(eraseHelper(n->getRight(), i - leftSize - 1, erased));
+    else
+    {
+        erased = n;
+        if(n->getLeft() == NULL)
+            return n->getRight();
+        if(n->getRight() == NULL)
+            return n->getLeft();
+        N* next;
+        N* right = removeFirst(n->getRight(), next);
+        next->setLeft(n->getLeft());
+        next->setRight(right);
+        return rebalance(next);
+    }
+    return rebalance(n);
+}
+
+template<typename Value>
+void AVLSequence<Value>::erase_at(size_t i)
+{
+    if(i >= size())
+        throw std::out_of_range("Invalid index");
+    N* erased = NULL;
+    root_ = eraseHelper(root_, i, erased);
+    delete erased;
+}
+
+template<typename Value>
+void AVLSequence<Value>::split_at(size_t i, AVLSequence<Value>& rest)
+{
+    if(i > size())
+        throw std::out_of_range("Invalid index");
+    if(&rest == this || !rest.empty())
+        throw std::invalid_argument("split_at needs an empty destination");
+    N* left;
+    N* right;
+    split(root_, i, left, right);
+    root_ = left;
+    rest.root_ = right;
+}
+
+template<typename Value>
+void AVLSequence<Value>::concat(AVLSequence<Value>& other)
+{
+    if(&other == this || other.root_ == NULL)
+        return;
+    N* first;
+    N* right = removeFirst(other.root_, first);
+    other.root_ = NULL;
+    root_ = join(root_, first, right);
+}
+
+#endif
@@ -0,0 +1,508 @@
+#ifndef AVLSET_H
+#define AVLSET_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+* A node of AVLSet: a key, the three links and the balance, and nothing
+* else. Unlike AVLNode there is no value, no std::pair and no vtable, so
+* for a uint64_t key a node is 40 bytes instead of 56 for AVLNode<uint64_t, bool>.
+*/
+template <typename Key>
+class SetNode
+{
+public:
+    SetNode(const Key& key, SetNode<Key>* parent);
+
+    const Key& getKey() const;
+    SetNode<Key>* getParent() const;
+    SetNode<Key>* getLeft() const;
+    SetNode<Key>* getRight() const;
+    void setParent(SetNode<Key>* parent);
+    void setLeft(SetNode<Key>* left);
+    void setRight(SetNode<Key>* right);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+protected:
+    const Key key_;
+    SetNode<Key>* parent_;
+    SetNode<Key>* left_;
+    SetNode<Key>* right_;
+    int8_t balance_;    // height(right) - height(left), as in AVLNode
+};
+
+template<typename Key>
+SetNode<Key>::SetNode(const Key& key, SetNode<Key>* parent) :
+    key_(key), parent_(parent), left_(NULL), right_(NULL), balance_(0)
+{
+
+}
+
+template<typename Key>
+const Key& SetNode<Key>::getKey() const
+{
+    return key_;
+}
+
+template<typename Key>
+SetNode<Key>* SetNode<Key>::getParent() const
+{
+    return parent_;
+}
+
+template<typename Key>
+SetNode<Key>* SetNode<Key>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key>
+SetNode<Key>* SetNode<Key>::getRight() const
+{
+    return right_;
+}
+
+template<typename Key>
+void SetNode<Key>::setParent(SetNode<Key>* parent)
+{
+    parent_ = parent;
+}
+
+template<typename Key>
+void SetNode<Key>::setLeft(SetNode<Key>* left)
+{
+    left_ = left;
+}
+
+template<typename Key>
+void SetNode<Key>::setRight(SetNode<Key>* right)
+{
+    right_ = right;
+}
+
+template<typename Key>
+int8_t SetNode<Key>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key>
+void SetNode<Key>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/**
+* An ordered set of keys in an AVL tree, for the trees that used to be
+* AVLTree<Key, bool> or AVLTree<Key, char> only for their keys. insert,
+* remove, find and iteration work as in AVLTree, but the iterator gives
+* the keys themselves (const, since changing one would break the order).
+*/
+template <typename Key>
+class AVLSet
+{
+public:
+    AVLSet();
+    ~AVLSet();
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        const Key& operator*() const;
+        const Key* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class AVLSet<Key>;
+        iterator(SetNode<Key>* ptr);
+        SetNode<Key>* current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    bool contains(const Key& key) const;
+
+    void insert(const Key& key);    // no effect if key is already there
+    void remove(const Key& key);    // no effect if key is missing
+    void clear();
+    size_t size() const;
+    bool empty() const;
+
+protected:
+    typedef SetNode<Key> N;
+
+    void rotateLeft(N* n);
+    void rotateRight(N* n);
+    N* rebalanceAt(N* n);
+    void replaceChild(N* parent, N* oldChild, N* newChild);
+    static N* successor(N* n);
+    static void clearHelper(N* n);
+
+    N* root_;
+    size_t size_;
+
+private:
+    AVLSet(const AVLSet&) = delete;
+    AVLSet& operator=(const AVLSet&) = delete;
+};
+
+template<typename Key>
+AVLSet<Key>::iterator::iterator() : current_(NULL)
+{
+
+}
+
+template<typename Key>
+AVLSet<Key>::iterator::iterator(SetNode<Key>* ptr) : current_(ptr)
+{
+
+}
+
+template<typename Key>
+const Key& AVLSet<Key>::iterator::operator*() const
+{
+    return current_->getKey();
+}
+
+template<typename Key>
+const Key* AVLSet<Key>::iterator::operator->() const
+{
+    return &(current_->getKey());
+}
+
+template<typename Key>
+bool AVLSet<Key>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<typename Key>
+bool AVLSet<Key>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<typename Key>
+typename AVLSet<Key>::iterator& AVLSet<Key>::iterator::operator++()
+{
+    current_ = AVLSet<Key>::successor(current_);
+    return *this;
+}
+
+template<typename Key>
+AVLSet<Key>::AVLSet() : root_(NULL), size_(0)
+{
+
+}
+
+template<typename Key>
+AVLSet<Key>::~AVLSet()
+{
+    clear();
+}
+
+template<typename Key>
+typename AVLSet<Key>::iterator AVLSet<Key>::begin() const
+{
+    N* n = root_;
+    while(n != NULL && n->getLeft() != NULL)
+        n = n->getLeft();
+    return iterator(n);
+}
+
+template<typename Key>
+typename AVLSet<Key>::iterator AVLSet<Key>::end() const
+{
+    return iterator(NULL);
+}
+
+template<typename Key>
+typename AVLSet<Key>::iterator AVLSet<Key>::find(const Key& key) const
+{
+    N* n = root_;
+    while(n != NULL)
+    {
+        if(key < n->getKey())
+            n = n->getLeft();
+        else if(n->getKey() < key)
+            n = n->getRight();
+        else
+            break;
+    }
+    return iterator(n);
+}
+
+template<typename Key>
+bool AVLSet<Key>::contains(const Key& key) const
+{
+    return find(key) != end();
+}
+
+template<typename Key>
+size_t AVLSet<Key>::size() const
+{
+    return size_;
+}
+
+template<typename Key>
+bool AVLSet<Key>::empty() const
+{
+    return size_ == 0;
+}
+
+template<typename Key>
+void AVLSet<Key>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+    size_ = 0;
+}
+
+template<typename Key>
+void AVLSet<Key>::clearHelper(N* n)
+{
+    if(n == NULL)
+        return;
+    clearHelper(n->getLeft());
+    clearHelper(n->getRight());
+    delete n;
+}
+
+template<typename Key>
+typename AVLSet<Key>::N* AVLSet<Key>::successor(N* n)
+{
+    if(n->getRight() != NULL)
+    {
+        n = n->getRight();
+        while(n->getLeft() != NULL)
+            n = n->getLeft();
+        return n;
+    }
+    while(n->getParent() != NULL && n->getParent()->getRight() == n)
+        n = n->getParent();
+    return n->getParent();
+}
+
+// Points parent's link to oldChild (or root_) at newChild
+template<typename Key>
+void AVLSet<Key>::replaceChild(N* parent, N* oldChild, N* newChild)
+{
+    if(parent == NULL)
+        root_ = newChild;
+    else if(parent->getLeft() == oldChild)
+        parent->setLeft(newChild);
+    else
+        parent->setRight(newChild);
+    if(newChild != NULL)
+        newChild->setParent(parent);
+}
+
+template<typename Key>
+void AVLSet<Key>::rotateLeft(N* n)
+{
+    N* newParent = n->getRight();
+    replaceChild(n->getParent(), n, newParent);
+    n->setRight(newParent->getLeft());
+    if(newParent->getLeft() != NULL)
+        newParent->getLeft()->setParent(n);
+    newParent->setLeft(n);
+    n->setParent(newParent);
+}
+
+template<typename Key>
+void AVLSet<Key>::rotateRight(N* n)
+{
+    N* newParent = n->getLeft();
+    replaceChild(n->getParent(), n, newParent);
+    n->setLeft(newParent->getRight());
+    if(newParent->getRight() != NULL)
+        newParent->getRight()->setParent(n);
+    newParent->setRight(n);
+    n->setParent(newParent);
+}
+
+/**
+* Fixes a node with balance -2 or 2 (the zig zig and zig zag cases of
+* AVLTree's insertFix/removeFix in one place) and returns the subtree's
+* new root. After a remove, the subtree kept its height only if the new
+* root's balance is not 0.
+*/
+template<typename Key>
+typename AVLSet<Key>::N* AVLSet<Key>::rebalanceAt(N* n)
+{
+    if(n->getBalance() > 0)
+    {
+        N* c = n->getRight();
+        if(c->getBalance() < 0) //zig zag
+        {
+            N* g = c->getLeft();
+            rotateRight(c);
+            rotateLeft(n);
+            n->setBalance(g->getBalance() > 0 ? -1 : 0);
+            c->setBalance(g->getBalance() < 0 ? 1 : 0);
+            g->setBalance(0);
+            return g;
+        }
+        rotateLeft(n); //zig zig
+        if(c->getBalance() == 0) //only after a remove
+        {
+            n->setBalance(1);
+            c->setBalance(-1);
+        }
+        else
+        {
+            n->setBalance(0);
+            c->setBalance(0);
+        }
+        return c;
+    }
+    N* c = n->getLeft();
+    if(c->getBalance() > 0) //zig zag
+    {
+        N* g = c->getRight();
+        rotateLeft(c);
+        rotateRight(n);
+        n->setBalance(g->getBalance() < 0 ? 1 : 0);
+        c->setBalance(g->getBalance() > 0 ? -1 : 0);
+        g->setBalance(0);
+        return g;
+    }
+    rotateRight(n); //zig zig
+    if(c->getBalance() == 0)
+    {
+        n->setBalance(-1);
+        c->setBalance(1);
+    }
+    else
+    {
+        n->setBalance(0);
+        c->setBalance(0);
+    }
+    return c;
+}
+
+/**
+* Links a new leaf, then walks up adjusting balances until a subtree's
+* height stops growing; at most one (single or double) rotation.
+*/
+template<typename Key>
+void AVLSet<Key>::insert(const Key& key)
+{
+    N* parent = NULL;
+    N* n = root_;
+    bool asLeft = false;
+    while(n != NULL)
+    {
+        parent = n;
+        if(key < n->getKey())
+        {
+            n = n->getLeft();
+            asLeft = true;
+        }
+        else if(n->getKey() < key)
+        {
+            n = n->getRight();
+            asLeft = false;
+        }
+        else
+            return;
+    }
+    N* child = new N(key, parent);
+    size_++;
+    if(parent == NULL)
+    {
+        root_ = child;
+        return;
+    }
+    if(asLeft)
+        parent->setLeft(child);
+    else
+        parent->setRight(child);
+
+    for(N* p = parent; p != NULL; child = p, p = p->getParent())
+    {
+        p->setBalance(p->getBalance() + (p->getLeft() == child ? -1 : 1));
+        if(p->getBalance() == 0)
+            return;
+        if(p->getBalance() == 2 || p->getBalance() == -2)
+        {
+            rebalanceAt(p);
+            return;
+        }
+    }
+}
+
+/**
+* A node with two children is replaced by its predecessor, as in AVLTree.
+* Then balances are adjusted upwards from where a subtree got shorter,
+* until one keeps its height.
+*/
+template<typename Key>
+void AVLSet<Key>::remove(const Key& key)
+{
+    N* n = find(key).current_;
+    if(n == NULL)
+        return;
+
+    N* fixFrom;         // lowest node whose subtree got shorter
+    bool fromLeft;      // ...on its left side
+    if(n->getLeft() != NULL && n->getRight() != NULL)
+    {
+        N* pred = n->getLeft();
+        while(pred->getRight() != NULL)
+            pred = pred->getRight();
+        if(pred == n->getLeft())
+        {
+            fixFrom = pred;
+            fromLeft = true;
+        }
+        else
+        {
+            fixFrom = pred->getParent();
+            fromLeft = false;
+            replaceChild(fixFrom, pred, pred->getLeft());
+            pred->setLeft(n->getLeft());
+            n->getLeft()->setParent(pred);
+        }
+        replaceChild(n->getParent(), n, pred);
+        pred->setRight(n->getRight());
+        n->getRight()->setParent(pred);
+        pred->setBalance(n->getBalance());
+    }
+    else
+    {
+        fixFrom = n->getParent();
+        fromLeft = fixFrom != NULL && fixFrom->getLeft() == n;
+        replaceChild(fixFrom, n, n->getLeft() != NULL ? n->getLeft() : n->getRight());
+    }
+    delete n;
+    size_--;
+
+    for(N* p = fixFrom; p != NULL; )
+    {
+        p->setBalance(p->getBalance() + (fromLeft ? 1 : -1));
+        N* g = p->getParent();
+        bool pLeft = g != NULL && g->getLeft() == p;
+        if(p->getBalance() == 1 || p->getBalance() == -1)
+            return;
+        if(p->getBalance() == 2 || p->getBalance() == -2)
+        {
+            if(rebalanceAt(p)->getBalance() != 0)
+                return;
+        }
+        p = g;
+        fromLeft = pLeft;
+    }
+}
+
+#endif
@@ -0,0 +1,889 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <iterator>
+#include <stdexcept>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "bst.h"
+#include "avlbst.h"
+#include "splaybst.h"
+#include "btree.h"
+#include "augavl.h"
+#include "interval-tree.h"
+#include "avlmulti.h"
+#include "avlset.h"
+#include "avlcompact.h"
+
+using namespace std;
+
+// Micro benchmarks for the search trees.
+// Usage: ./bst-bench [benchmark name] [number of keys]
+// With no name every benchmark is run.
+
+typedef std::chrono::steady_clock Clock;
+
+static double nsPer(Clock::time_point start, Clock::time_point stop, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(stop - start).count() / count;
+}
+
+static void report(const string& what, double ns)
+{
+    cout << "  " << left << setw(36) << what << right << fixed << setprecision(1)
+         << setw(10) << ns << " ns/op" << endl;
+}
+
+// n distinct keys in random order
+static vector<uint64_t> shuffledKeys(size_t n, mt19937_64& rng)
+{
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = i * 2654435761ULL;
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// Draws ranks 0..n-1 with P(rank r) proportional to 1/(r+1)^s
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(size_t n, double s) : cdf_(n)
+    {
+        double sum = 0;
+        for(size_t i = 0; i < n; i++)
+        {
+            sum += 1.0 / pow(double(i + 1), s);
+            cdf_[i] = sum;
+        }
+        for(size_t i = 0; i < n; i++)
+            cdf_[i] /= sum;
+    }
+    size_t operator()(mt19937_64& rng)
+    {
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+    }
+private:
+    vector<double> cdf_;
+};
+
+template<class Tree>
+static double timeFinds(Tree& tree, const vector<uint64_t>& probes)
+{
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); i++)
+        sum += tree.find(probes[i])->second;
+    Clock::time_point stop = Clock::now();
+    if(sum == 1) cout << "";  // keep the loop alive
+    return nsPer(start, stop, probes.size());
+}
+
+// Zipf-distributed hits: a few hot keys get most lookups
+static void benchSplay(size_t n)
+{
+    cout << "splay: " << n << " keys, Zipf(0.99) hits" << endl;
+    mt19937_64 rng(42);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+
+    AVLTree<uint64_t, uint64_t> avl;
+    SplayTree<uint64_t, uint64_t> splay;
+    for(size_t i = 0; i < n; i++)
+    {
+        avl.insert(std::make_pair(keys[i], i));
+        splay.insert(std::make_pair(keys[i], i));
+    }
+
+    ZipfGenerator zipf(n, 0.99);
+    vector<uint64_t> probes(std::max<size_t>(n, 1000000));
+    for(size_t i = 0; i < probes.size(); i++)
+        probes[i] = keys[zipf(rng)];
+
+    report("AVLTree::find", timeFinds(avl, probes));
+    report("SplayTree::find", timeFinds(splay, probes));
+}
+
+template<class Tree>
+static double timeInserts(Tree& tree, const vector<uint64_t>& keys)
+{
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); i++)
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    return nsPer(start, Clock::now(), keys.size());
+}
+
+template<class Tree>
+static double timeScan(const Tree& tree, size_t n)
+{
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+        sum += it->second;
+    Clock::time_point stop = Clock::now();
+    if(sum == 1) cout << "";
+    return nsPer(start, stop, n);
+}
+
+// Wide-node B+-tree against the AVL tree on uint64_t keys
+static void benchBTree(size_t n)
+{
+    cout << "btree: " << n << " random uint64_t keys" << endl;
+    mt19937_64 rng(7);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    vector<uint64_t> probes(keys);
+    shuffle(probes.begin(), probes.end(), rng);
+
+    AVLTree<uint64_t, uint64_t> avl;
+    BTreeMap<uint64_t, uint64_t> btree;
+    report("AVLTree::insert", timeInserts(avl, keys));
+    report("BTreeMap::insert", timeInserts(btree, keys));
+    report("AVLTree::find", timeFinds(avl, probes));
+    report("BTreeMap::find", timeFinds(btree, probes));
+    report("AVLTree scan (per item)", timeScan(avl, n));
+    report("BTreeMap scan (per item)", timeScan(btree, n));
+}
+
+// Lookup throughput of BTreeMap<Key> with each in-node search instruction set
+template<class Key>
+static void benchSimdKey(const string& name, size_t n)
+{
+    mt19937_64 rng(11);
+    vector<uint64_t> raw = shuffledKeys(n, rng);
+    vector<Key> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = Key(raw[i] >> 3);
+    BTreeMap<Key, uint64_t> btree;
+    for(size_t i = 0; i < n; i++)
+        btree.insert(std::make_pair(keys[i], uint64_t(i)));
+
+    const char* levels[] = { "scalar", "sse4.2", "avx2" };
+    for(int level = SIMD_SCALAR; level <= SIMD_AVX2; level++)
+    {
+        if(!setSimdLevel(SimdLevel(level)))
+            continue;
+        uint64_t sum = 0;
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < n; i++)
+        {
+            typename BTreeMap<Key, uint64_t>::iterator it = btree.find(keys[i]);
+            if(it != btree.end())
+                sum += it->second;
+        }
+        Clock::time_point stop = Clock::now();
+        if(sum == 1) cout << "";
+        report(name + " find, " + levels[level], nsPer(start, stop, n));
+    }
+    setSimdLevel(detectSimdLevel());
+}
+
+static void benchSimd(size_t n)
+{
+    cout << "simd: BTreeMap lookups, " << n << " keys" << endl;
+    benchSimdKey<uint64_t>("uint64_t", n);
+    benchSimdKey<int32_t>("int32_t", n);
+    benchSimdKey<int16_t>("int16_t", std::min<size_t>(n, 30000));
+}
+
+// Nearly sorted timestamps: sorted, then each key swapped with a close neighbour
+static void benchAppend(size_t n)
+{
+    cout << "append: " << n << " nearly sorted uint64_t keys" << endl;
+    mt19937_64 rng(5);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = i * 8;
+    for(size_t i = 0; i + 8 < n; i += 8)
+        std::swap(keys[i], keys[i + rng() % 8]);
+    vector<uint64_t> shuffled(keys);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    AVLTree<uint64_t, uint64_t> random, sorted, hinted;
+    report("AVLTree::insert, random order", timeInserts(random, shuffled));
+    report("AVLTree::insert, nearly sorted", timeInserts(sorted, keys));
+    Clock::time_point start = Clock::now();
+    AVLTree<uint64_t, uint64_t>::iterator last = hinted.end();
+    for(size_t i = 0; i < n; i++)
+    {
+        //the previous key's successor is the likely spot for the next one
+        if(last != hinted.end())
+            ++last;
+        last = hinted.insert(last, std::make_pair(keys[i], keys[i]));
+    }
+    report("AVLTree::insert(hint), nearly sorted", nsPer(start, Clock::now(), n));
+}
+
+// Sorted probe batches: repeated find() against find_sorted()
+static void benchFinger(size_t n)
+{
+    cout << "finger: sorted probes into " << n << " uint64_t keys" << endl;
+    mt19937_64 rng(9);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    AVLTree<uint64_t, uint64_t> avl;
+    for(size_t i = 0; i < n; i++)
+        avl.insert(std::make_pair(keys[i], keys[i]));
+
+    for(size_t k = std::max<size_t>(n / 1000, 1); k <= n; k *= 10)
+    {
+        vector<uint64_t> probes(keys.begin(), keys.begin() + k);
+        sort(probes.begin(), probes.end());
+        vector<AVLTree<uint64_t, uint64_t>::iterator> out(k);
+
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < k; i++)
+            out[i] = avl.find(probes[i]);
+        double plain = nsPer(start, Clock::now(), k);
+        start = Clock::now();
+        avl.find_sorted(probes.begin(), probes.end(), out.begin());
+        double finger = nsPer(start, Clock::now(), k);
+
+        string batch = " (k=" + std::to_string(k) + ")";
+        report("AVLTree::find" + batch, plain);
+        report("AVLTree::find_sorted" + batch, finger);
+    }
+}
+
+// Lookups that mostly miss: operator[] with a catch against try_get
+static void benchMiss(size_t n)
+{
+    cout << "miss: 90% missing lookups into " << n << " uint64_t keys" << endl;
+    mt19937_64 rng(13);
+    AVLTree<uint64_t, uint64_t> avl;
+    for(size_t i = 0; i < n; i++)
+        avl.insert(std::make_pair(uint64_t(i) * 10, uint64_t(i)));
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = (rng() % n) * 10 + (i % 10 == 0 ? 0 : 5);
+
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+    {
+        try {
+            sum += avl[probes[i]];
+        }
+        catch(const std::out_of_range&) {
+        }
+    }
+    report("AVLTree::operator[] + catch", nsPer(start, Clock::now(), n));
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+    {
+        const uint64_t* value = avl.try_get(probes[i]);
+        if(value != NULL)
+            sum += *value;
+    }
+    report("AVLTree::try_get", nsPer(start, Clock::now(), n));
+    if(sum == 1) cout << "";
+}
+
+// Sorted bulk load into the unbalanced tree, before and after rebalance()
+static void benchRebalance(size_t n)
+{
+    cout << "rebalance: " << n << " sorted uint64_t keys in a BinarySearchTree" << endl;
+    mt19937_64 rng(17);
+    BinarySearchTree<uint64_t, uint64_t> bst;
+    for(size_t i = 0; i < n; i++)
+        bst.insert(std::make_pair(uint64_t(i), uint64_t(i)));
+    vector<uint64_t> probes(std::min<size_t>(n, 1000));
+    for(size_t i = 0; i < probes.size(); i++)
+        probes[i] = rng() % n;
+
+    report("find, degenerate", timeFinds(bst, probes));
+    Clock::time_point start = Clock::now();
+    bst.rebalance();
+    report("rebalance (per item)", nsPer(start, Clock::now(), n));
+    report("find, rebalanced", timeFinds(bst, probes));
+
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = i;
+    BinarySearchTree<uint64_t, uint64_t> scapegoat;
+    scapegoat.setScapegoat(true);
+    AVLTree<uint64_t, uint64_t> avl;
+    report("scapegoat insert, sorted", timeInserts(scapegoat, keys));
+    report("AVLTree::insert, sorted", timeInserts(avl, keys));
+    report("scapegoat find", timeFinds(scapegoat, probes));
+    report("AVLTree::find", timeFinds(avl, probes));
+}
+
+// Full in-order scans with and without threads
+static void benchThreaded(size_t n)
+{
+    cout << "threaded: in-order scans of " << n << " random uint64_t keys" << endl;
+    mt19937_64 rng(19);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    AVLTree<uint64_t, uint64_t> plain, threaded;
+    threaded.setThreaded(true);
+    report("AVLTree::insert", timeInserts(plain, keys));
+    report("threaded AVLTree::insert", timeInserts(threaded, keys));
+    report("AVLTree scan (per item)", timeScan(plain, n));
+    report("threaded AVLTree scan (per item)", timeScan(threaded, n));
+}
+
+// Full scans: iterator against for_each (try n = 10000000)
+static void benchScan(size_t n)
+{
+    cout << "scan: " << n << " random uint64_t keys" << endl;
+    mt19937_64 rng(23);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    AVLTree<uint64_t, uint64_t> avl;
+    timeInserts(avl, keys);
+
+    report("AVLTree iterator (per item)", timeScan(avl, n));
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    avl.for_each([&sum](const std::pair<const uint64_t, uint64_t>& item) { sum += item.second; });
+    Clock::time_point stop = Clock::now();
+    if(sum == 1) cout << "";
+    report("AVLTree::for_each (per item)", nsPer(start, stop, n));
+}
+
+// parallel_reduce sum against a single-threaded for_each, by thread count
+static void benchParallel(size_t n)
+{
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    cout << "parallel: reduce over " << n << " random uint64_t keys, "
+         << hardware << " hardware threads" << endl;
+    mt19937_64 rng(29);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    AVLTree<uint64_t, uint64_t> avl;
+    timeInserts(avl, keys);
+
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    avl.for_each([&sum](const std::pair<const uint64_t, uint64_t>& item) { sum += item.second; });
+    report("for_each sum (per item)", nsPer(start, Clock::now(), n));
+
+    for(unsigned threads = 1; threads <= hardware * 2; threads *= 2)
+    {
+        start = Clock::now();
+        uint64_t total = avl.parallel_reduce(uint64_t(0),
+            [](const std::pair<const uint64_t, uint64_t>& item) { return item.second; },
+            [](uint64_t a, uint64_t b) { return a + b; }, threads);
+        double ns = nsPer(start, Clock::now(), n);
+        if(total != sum) cout << "  parallel_reduce sum mismatch!" << endl;
+        report("parallel_reduce, " + std::to_string(threads) + " threads", ns);
+    }
+
+    //the same reduce on a pool that outlives the call
+    TaskPool pool(hardware);
+    start = Clock::now();
+    uint64_t total = avl.parallel_reduce(uint64_t(0),
+        [](const std::pair<const uint64_t, uint64_t>& item) { return item.second; },
+        [](uint64_t a, uint64_t b) { return a + b; }, pool);
+    double ns = nsPer(start, Clock::now(), n);
+    if(total != sum) cout << "  parallel_reduce sum mismatch!" << endl;
+    report("parallel_reduce, caller's pool", ns);
+}
+
+// Cold start: an insert loop against build_parallel on unsorted records
+static void benchBuild(size_t n)
+{
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    cout << "build: " << n << " unsorted records with duplicates, "
+         << hardware << " hardware threads" << endl;
+    mt19937_64 rng(31);
+    vector<pair<uint64_t, uint64_t> > records(n);
+    for(size_t i = 0; i < n; i++)
+        records[i] = std::make_pair(rng() % n, uint64_t(i));
+
+    Clock::time_point start = Clock::now();
+    {
+        AVLTree<uint64_t, uint64_t> avl;
+        for(size_t i = 0; i < n; i++)
+            avl.insert(records[i]);
+        report("insert loop (per record)", nsPer(start, Clock::now(), n));
+    }
+    for(unsigned threads = 1; threads <= hardware * 2; threads *= 2)
+    {
+        AVLTree<uint64_t, uint64_t> avl;
+        start = Clock::now();
+        avl.build_parallel(records.begin(), records.end(), threads);
+        report("build_parallel, " + std::to_string(threads) + " threads", nsPer(start, Clock::now(), n));
+    }
+}
+
+// Range sums: iterating the range against AugmentedAVLTree::aggregate
+static void benchAggregate(size_t n)
+{
+    cout << "aggregate: range sums over " << n << " uint64_t keys" << endl;
+    mt19937_64 rng(37);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = i;
+    shuffle(keys.begin(), keys.end(), rng);
+    AugmentedAVLTree<uint64_t, uint64_t, SumMonoid<uint64_t> > aug;
+    timeInserts(aug, keys);
+    const size_t queries = 1000;
+    const uint64_t width = n / 100; // each range holds 1% of the keys
+    vector<uint64_t> starts(queries);
+    for(size_t i = 0; i < queries; i++)
+        starts[i] = rng() % n;
+
+    uint64_t scanned = 0, aggregated = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < queries; i++)
+    {
+        AVLTree<uint64_t, uint64_t>::iterator it = aug.find(starts[i]);
+        for(; it != aug.end() && it->first <= starts[i] + width; ++it)
+            scanned += it->second;
+    }
+    report("iterate the range", nsPer(start, Clock::now(), queries));
+    start = Clock::now();
+    for(size_t i = 0; i < queries; i++)
+        aggregated += aug.aggregate(starts[i], starts[i] + width);
+    report("aggregate(lo, hi)", nsPer(start, Clock::now(), queries));
+    if(scanned != aggregated) cout << "  range sum mismatch!" << endl;
+}
+
+// Stabbing queries: IntervalTree against a linear scan of the intervals
+static void benchInterval(size_t n)
+{
+    cout << "interval: stabbing queries over " << n << " intervals" << endl;
+    mt19937_64 rng(41);
+    const uint64_t span = n * 100;
+    vector<Interval<uint64_t> > intervals;
+    IntervalTree<uint64_t, uint64_t> tree;
+    for(size_t i = 0; i < n; i++)
+    {
+        uint64_t start = rng() % span;
+        uint64_t end = start + rng() % 1000;
+        intervals.push_back(Interval<uint64_t>(start, end));
+        tree.insert(start, end, uint64_t(i));
+    }
+    const size_t queries = 200;
+    vector<uint64_t> points(queries);
+    for(size_t i = 0; i < queries; i++)
+        points[i] = rng() % span;
+
+    size_t scanned = 0, found = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t q = 0; q < queries; q++)
+    {
+        for(size_t i = 0; i < intervals.size(); i++)
+            scanned += (intervals[i].start <= points[q] && points[q] <= intervals[i].end);
+    }
+    report("linear scan", nsPer(start, Clock::now(), queries));
+    vector<IntervalTree<uint64_t, uint64_t>::iterator> out;
+    start = Clock::now();
+    for(size_t q = 0; q < queries; q++)
+    {
+        out.clear();
+        tree.stabbing(points[q], std::back_inserter(out));
+        found += out.size();
+    }
+    report("IntervalTree::stabbing", nsPer(start, Clock::now(), queries));
+    if(scanned != found) cout << "  stabbing count mismatch!" << endl;
+}
+
+// The vector-per-key emulation of a multimap (printRoot needs operator<<)
+struct Bucket
+{
+    vector<uint64_t> values;
+};
+
+static ostream& operator<<(ostream& out, const Bucket& bucket)
+{
+    return out << bucket.values.size() << " values";
+}
+
+// Duplicate keys: AVLMultiMap against an AVLTree of vectors of values
+static void benchMulti(size_t n)
+{
+    cout << "multi: " << n << " items, about 8 per key" << endl;
+    mt19937_64 rng(43);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = rng() % (n / 8 + 1);
+    AVLMultiMap<uint64_t, uint64_t> multi;
+    AVLTree<uint64_t, Bucket> buckets;
+    report("AVLMultiMap::insert", timeInserts(multi, keys));
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        buckets.get_or_insert(keys[i]).values.push_back(keys[i]);
+    report("AVLTree<vector>::get_or_insert", nsPer(start, Clock::now(), n));
+
+    uint64_t fromMulti = 0, fromBuckets = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+    {
+        typedef AVLMultiMap<uint64_t, uint64_t>::iterator It;
+        std::pair<It, It> range = multi.equal_range(keys[i]);
+        for(; range.first != range.second; ++range.first)
+            fromMulti += range.first->second;
+    }
+    report("AVLMultiMap::equal_range", nsPer(start, Clock::now(), n));
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+    {
+        const vector<uint64_t>& values = buckets.at(keys[i]).values;
+        for(size_t j = 0; j < values.size(); j++)
+            fromBuckets += values[j];
+    }
+    report("AVLTree<vector>::at", nsPer(start, Clock::now(), n));
+    if(fromMulti != fromBuckets) cout << "  duplicate sum mismatch!" << endl;
+}
+
+// Bytes the allocator has handed out (0 where we can't ask)
+static size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;     // small blocks + mmapped ones
+#else
+    return 0;
+#endif
+}
+
+// Key-only storage: AVLSet against the AVLTree<Key, bool> it replaces
+static void benchSet(size_t n)
+{
+    cout << "set: " << n << " uint64_t keys, AVLSet vs AVLTree<uint64_t, bool>" << endl;
+    mt19937_64 rng(47);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = keys[rng() % n];
+
+    size_t heap = heapInUse();
+    AVLTree<uint64_t, bool>* map = new AVLTree<uint64_t, bool>;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        map->insert(std::make_pair(keys[i], true));
+    report("AVLTree<uint64_t, bool>::insert", nsPer(start, Clock::now(), n));
+    size_t mapBytes = heapInUse() - heap;
+    heap = heapInUse();
+    AVLSet<uint64_t>* set = new AVLSet<uint64_t>;
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        set->insert(keys[i]);
+    report("AVLSet<uint64_t>::insert", nsPer(start, Clock::now(), n));
+    size_t setBytes = heapInUse() - heap;
+
+    size_t hits = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        hits += map->find(probes[i]) != map->end();
+    report("AVLTree<uint64_t, bool>::find", nsPer(start, Clock::now(), n));
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        hits += set->contains(probes[i]);
+    report("AVLSet<uint64_t>::contains", nsPer(start, Clock::now(), n));
+    if(hits != 2 * n) cout << "  lookup mismatch!" << endl;
+
+    cout << "  node size: AVLNode " << sizeof(AVLNode<uint64_t, bool>) << " bytes, SetNode "
+         << sizeof(SetNode<uint64_t>) << " bytes" << endl;
+    if(mapBytes != 0 && setBytes != 0)
+        cout << "  heap per key: map " << fixed << setprecision(1) << double(mapBytes) / n
+             << " bytes, set " << double(setBytes) / n << " bytes" << endl;
+    delete map;
+    delete set;
+}
+
+// Index-linked nodes in one vector against the pointer-linked AVLTree
+static void benchCompact(size_t n)
+{
+    cout << "compact: " << n << " uint64_t -> uint64_t, CompactAVLTree vs AVLTree" << endl;
+    mt19937_64 rng(53);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = keys[rng() % n];
+
+    size_t heap = heapInUse();
+    AVLTree<uint64_t, uint64_t>* avl = new AVLTree<uint64_t, uint64_t>;
+    report("AVLTree::insert", timeInserts(*avl, keys));
+    size_t avlBytes = heapInUse() - heap;
+    heap = heapInUse();
+    CompactAVLTree<uint64_t, uint64_t>* compact = new CompactAVLTree<uint64_t, uint64_t>;
+    compact->reserve(n);
+    report("CompactAVLTree::insert", timeInserts(*compact, keys));
+    size_t compactBytes = heapInUse() - heap;
+
+    report("AVLTree::find", timeFinds(*avl, probes));
+    report("CompactAVLTree::find", timeFinds(*compact, probes));
+    report("AVLTree scan", timeScan(*avl, n));
+    report("CompactAVLTree scan", timeScan(*compact, n));
+
+    cout << "  node size: AVLNode " << sizeof(AVLNode<uint64_t, uint64_t>) << " bytes, CompactNode "
+         << sizeof(CompactNode<uint64_t, uint64_t>) << " bytes" << endl;
+    if(avlBytes != 0 && compactBytes != 0)
+        cout << "  heap per key: AVLTree " << fixed << setprecision(1) << double(avlBytes) / n
+             << " bytes, CompactAVLTree " << double(compactBytes) / n << " bytes" << endl;
+    delete avl;
+    delete compact;
+}
+
+template<class Tree>
+static double timeRemoves(Tree& tree, const vector<uint64_t>& keys)
+{
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); i++)
+        tree.remove(keys[i]);
+    return nsPer(start, Clock::now(), keys.size());
+}
+
+// Parent-free heap nodes with path-stack retracing against AVLTree
+static void benchParentFree(size_t n)
+{
+    cout << "parentfree: " << n << " uint64_t -> uint64_t, LinkedNodes vs AVLTree" << endl;
+    typedef CompactAVLTree<uint64_t, uint64_t, LinkedNodes<uint64_t, uint64_t> > LeanTree;
+    mt19937_64 rng(59);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = keys[rng() % n];
+    vector<uint64_t> half(keys.begin(), keys.begin() + n / 2);
+
+    size_t heap = heapInUse();
+    AVLTree<uint64_t, uint64_t>* avl = new AVLTree<uint64_t, uint64_t>;
+    report("AVLTree::insert", timeInserts(*avl, keys));
+    size_t avlBytes = heapInUse() - heap;
+    heap = heapInUse();
+    LeanTree* lean = new LeanTree;
+    report("parent-free insert", timeInserts(*lean, keys));
+    size_t leanBytes = heapInUse() - heap;
+
+    report("AVLTree::find", timeFinds(*avl, probes));
+    report("parent-free find", timeFinds(*lean, probes));
+    report("AVLTree scan", timeScan(*avl, n));
+    report("parent-free scan", timeScan(*lean, n));
+    report("AVLTree::remove", timeRemoves(*avl, half));
+    report("parent-free remove", timeRemoves(*lean, half));
+
+    cout << "  node size: AVLNode " << sizeof(AVLNode<uint64_t, uint64_t>) << " bytes, LinkedNode "
+         << sizeof(LinkedNode<uint64_t, uint64_t>) << " bytes" << endl;
+    if(avlBytes != 0 && leanBytes != 0)
+        cout << "  heap per key: AVLTree " << fixed << setprecision(1) << double(avlBytes) / n
+             << " bytes, parent-free " << double(leanBytes) / n << " bytes" << endl;
+    delete avl;
+    delete lean;
+}
+
+// A 1KB value, the kind that drowns the keys when stored next to them
+struct Blob
+{
+    uint64_t words[128];
+};
+
+// Time per key of key-only range scans [start, start + width]
+template<class Tree>
+static double timeKeyScans(const Tree& tree, const vector<uint64_t>& starts, uint64_t width)
+{
+    uint64_t sum = 0;
+    size_t visited = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < starts.size(); i++)
+    {
+        typename Tree::iterator it = tree.lower_bound(starts[i]);
+        for(; it != tree.end() && it->first <= starts[i] + width; ++it, ++visited)
+            sum += it->first;
+    }
+    Clock::time_point stop = Clock::now();
+    if(sum == 1) cout << "";
+    return nsPer(start, stop, visited);
+}
+
+// Structure-of-arrays nodes against whole nodes, with 1KB values
+static void benchSoA(size_t n)
+{
+    n = min(n, size_t(200000));     // n KB of values per tree
+    cout << "soa: " << n << " uint64_t -> 1KB values, SplitNodes vs IndexedNodes" << endl;
+    typedef CompactAVLTree<uint64_t, Blob> WholeTree;
+    typedef CompactAVLTree<uint64_t, Blob, SplitNodes<uint64_t, Blob> > SplitTree;
+    mt19937_64 rng(61);
+    vector<uint64_t> keys(n);
+    for(size_t i = 0; i < n; i++)
+        keys[i] = i;
+    shuffle(keys.begin(), keys.end(), rng);
+    Blob blob;
+    for(size_t i = 0; i < 128; i++)
+        blob.words[i] = i;
+
+    WholeTree* whole = new WholeTree;
+    SplitTree* split = new SplitTree;
+    whole->reserve(n);
+    split->reserve(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        whole->insert(std::make_pair(keys[i], blob));
+        split->insert(std::make_pair(keys[i], blob));
+    }
+
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = rng() % n;
+    size_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        hits += whole->contains(probes[i]);
+    report("whole nodes contains", nsPer(start, Clock::now(), n));
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        hits += split->contains(probes[i]);
+    report("split nodes contains", nsPer(start, Clock::now(), n));
+    if(hits != 2 * n) cout << "  lookup mismatch!" << endl;
+
+    const size_t queries = 200;
+    vector<uint64_t> starts(queries);
+    for(size_t i = 0; i < queries; i++)
+        starts[i] = rng() % n;
+    const uint64_t width = n / 100;
+    double wholeNs = timeKeyScans(*whole, starts, width);
+    double splitNs = timeKeyScans(*split, starts, width);
+    report("whole nodes key range scan (per key)", wholeNs);
+    report("split nodes key range scan (per key)", splitNs);
+    cout << "  key bandwidth: whole " << fixed << setprecision(1) << 8e3 / wholeNs
+         << " MB/s, split " << 8e3 / splitNs << " MB/s" << endl;
+    delete whole;
+    delete split;
+}
+
+// 256-byte values, one type opted in to out-of-line pooling
+struct WideValue
+{
+    uint64_t words[32];
+};
+
+struct InlineWideValue
+{
+    uint64_t words[32];
+};
+
+template<> struct ValueStorage<WideValue> { static const bool outOfLine = true; };
+
+static ostream& operator<<(ostream& out, const WideValue& value)
+{
+    return out << value.words[0];
+}
+
+static ostream& operator<<(ostream& out, const InlineWideValue& value)
+{
+    return out << value.words[0];
+}
+
+template<class Tree, class WideT>
+static double timeWideInserts(Tree& tree, const vector<uint64_t>& keys)
+{
+    WideT value;
+    for(size_t i = 0; i < 32; i++)
+        value.words[i] = i;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        value.words[0] = keys[i];
+        tree.insert(std::make_pair(keys[i], value));
+    }
+    return nsPer(start, Clock::now(), keys.size());
+}
+
+template<class Tree>
+static double timeWideFinds(Tree& tree, const vector<uint64_t>& probes)
+{
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); i++)
+        sum += tree.find(probes[i])->second.words[0];
+    Clock::time_point stop = Clock::now();
+    if(sum == 1) cout << "";
+    return nsPer(start, stop, probes.size());
+}
+
+// Pooled out-of-line values against values inside the AVLTree nodes
+static void benchValues(size_t n)
+{
+    n = min(n, size_t(500000));
+    cout << "values: " << n << " uint64_t -> 256-byte values, pooled vs inline" << endl;
+    mt19937_64 rng(67);
+    vector<uint64_t> keys = shuffledKeys(n, rng);
+    vector<uint64_t> probes(n);
+    for(size_t i = 0; i < n; i++)
+        probes[i] = keys[rng() % n];
+
+    size_t heap = heapInUse();
+    AVLTree<uint64_t, InlineWideValue>* inlined = new AVLTree<uint64_t, InlineWideValue>;
+    report("inline insert", timeWideInserts<AVLTree<uint64_t, InlineWideValue>, InlineWideValue>(*inlined, keys));
+    size_t inlineBytes = heapInUse() - heap;
+    heap = heapInUse();
+    AVLTree<uint64_t, WideValue>* pooled = new AVLTree<uint64_t, WideValue>;
+    report("pooled insert", timeWideInserts<AVLTree<uint64_t, WideValue>, WideValue>(*pooled, keys));
+    size_t pooledBytes = heapInUse() - heap;
+
+    report("inline find", timeWideFinds(*inlined, probes));
+    report("pooled find", timeWideFinds(*pooled, probes));
+    Clock::time_point start = Clock::now();
+    size_t hits = 0;
+    for(size_t i = 0; i < n; i++)
+        hits += inlined->contains(probes[i]);
+    report("inline contains (keys only)", nsPer(start, Clock::now(), n));
+    start = Clock::now();
+    for(size_t i = 0; i < n; i++)
+        hits += pooled->contains(probes[i]);
+    report("pooled contains (keys only)", nsPer(start, Clock::now(), n));
+    if(hits != 2 * n) cout << "  lookup mismatch!" << endl;
+
+    cout << "  node size: inline " << sizeof(AVLNode<uint64_t, InlineWideValue>) << " bytes, pooled "
+         << sizeof(AVLNode<uint64_t, WideValue>) << " bytes (+ "
+         << sizeof(std::pair<const uint64_t, WideValue>) << " in the pool)" << endl;
+    if(inlineBytes != 0 && pooledBytes != 0)
+        cout << "  heap per key: inline " << fixed << setprecision(1) << double(inlineBytes) / n
+             << " bytes, pooled " << double(pooledBytes) / n << " bytes" << endl;
+    delete inlined;
+    delete pooled;
+}
+
+int main(int argc, char *argv[])
+{
+    string which = argc > 1 ? argv[1] : "all";
+    size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+
+    if(which == "all" || which == "splay")
+        benchSplay(n);
+    if(which == "all" || which == "btree")
+        benchBTree(n);
+    if(which == "all" || which == "simd")
+        benchSimd(n);
+    if(which == "all" || which == "append")
+        benchAppend(n);
+    if(which == "all" || which == "finger")
+        benchFinger(n);
+    if(which == "all" || which == "miss")
+        benchMiss(n);
+    if(which == "all" || which == "rebalance")
+        benchRebalance(n);
+    if(which == "all" || which == "threaded")
+        benchThreaded(n);
+    if(which == "all" || which == "scan")
+        benchScan(n);
+    if(which == "all" || which == "parallel")
+        benchParallel(n);
+    if(which == "all" || which == "build")
+        benchBuild(n);
+    if(which == "all" || which == "aggregate")
+        benchAggregate(n);
+    if(which == "all" || which == "interval")
+        benchInterval(n);
+    if(which == "all" || which == "multi")
+        benchMulti(n);
+    if(which == "all" || which == "set")
+        benchSet(n);
+    if(which == "all" || which == "compact")
+        benchCompact(n);
+    if(which == "all" || which == "parentfree")
+        benchParentFree(n);
+    if(which == "all" || which == "soa")
+        benchSoA(n);
+    if(which == "all" || which == "values")
+        benchValues(n);
+    return 0;
+}
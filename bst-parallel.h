@@ -0,0 +1,213 @@
+#ifndef BST_PARALLEL_H
+#define BST_PARALLEL_H
+
+// Multi-threaded traversals for BinarySearchTree and the trees derived
+// from it. Included at the bottom of bst.h; programs that call these
+// need to be built with -pthread.
+//
+// The tree is cut at a fixed depth into whole subtrees (run as tasks on
+// a work-stealing TaskPool) and the few nodes above the cut (handled by
+// the calling thread). In a balanced tree the subtrees are about the
+// same size, and there are several per thread so stealing can even out
+// the rest. Every piece is a contiguous run of keys, so results can be
+// combined back in key order.
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "task-pool.h"
+
+/**
+* Lists the pieces of the subtree at n in key order: whole subtrees
+* (second == true) at depth levels below n, and single nodes above them.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::splitForTasks(Node<Key, Value>* n, int depth,
+    std::vector<std::pair<Node<Key, Value>*, bool> >& pieces)
+{
+    if(n == NULL)
+        return;
+    if(depth == 0)
+    {
+        pieces.push_back(std::make_pair(n, true));
+        return;
+    }
+    splitForTasks(n->getLeft(), depth - 1, pieces);
+    pieces.push_back(std::make_pair(n, false));
+    splitForTasks(n->getRight(), depth - 1, pieces);
+}
+
+/**
+* Stable sort of v on pool: each thread stable-sorts a slice, then rounds
+* of pairwise merges (also stable, in parallel within a round) join them.
+* Items that compare equal keep their input order. Call from outside the
+* pool.
+*/
+template<class T, class Compare>
+void parallelStableSort(std::vector<T>& v, Compare less, TaskPool& pool)
+{
+    size_t slices = pool.threads();
+    if(slices < 2 || v.size() < 16384)
+    {
+        std::stable_sort(v.begin(), v.end(), less);
+        return;
+    }
+    size_t width = (v.size() + slices - 1) / slices;
+    T* data = v.data();
+    size_t size = v.size();
+    for(size_t lo = 0; lo < size; lo += width)
+    {
+        size_t hi = std::min(lo + width, size);
+        pool.submit([data, lo, hi, less]() { std::stable_sort(data + lo, data + hi, less); });
+    }
+    pool.wait();
+    for(; width < size; width *= 2)
+    {
+        for(size_t lo = 0; lo + width < size; lo += 2 * width)
+        {
+            size_t mid = lo + width;
+            size_t hi = std::min(lo + 2 * width, size);
+            pool.submit([data, lo, mid, hi, less]() {
+                std::inplace_merge(data + lo, data + mid, data + hi, less);
+            });
+        }
+        pool.wait();
+    }
+}
+
+// Cut depth that gives about 8 subtrees per thread
+inline int parallelSplitDepth(unsigned threads)
+{
+    int depth = 0;
+    while((1u << depth) < 8 * threads && depth < 20)
+        depth++;
+    return depth;
+}
+
+/**
+* One partial result of parallel_reduce, padded so that workers filling
+* neighbouring partials do not share a cache line. A struct rather than
+* a bare T also keeps &value valid for T = bool.
+*/
+template<class T>
+struct ReducePartial
+{
+    explicit ReducePartial(const T& init) : value(init), filled(false) {}
+
+    T value;
+    bool filled;    // false for pieces with no live items
+    char pad[64];
+};
+
+/**
+* Calls fn(item) for every item, from threads threads (0: one per
+* hardware thread). fn runs concurrently and in no particular order
+* across subtrees, so it must be safe to call from several threads.
+* The tree must not change until this returns.
+*/
+template<class Key, class Value>
+template<class Function>
+void BinarySearchTree<Key, Value>::parallel_for_each(Function fn, unsigned threads) const
+{
+    TaskPool pool(threads);
+    parallel_for_each(fn, pool);
+}
+
+/**
+* As above, on the caller's pool. Call from outside the pool; this waits
+* for everything submitted to it.
+*/
+template<class Key, class Value>
+template<class Function>
+void BinarySearchTree<Key, Value>::parallel_for_each(Function fn, TaskPool& pool) const
+{
+    std::vector<std::pair<Node<Key, Value>*, bool> > pieces;
+    splitForTasks(root_, parallelSplitDepth(pool.threads()), pieces);
+
+    Function* f = &fn;
+    for(size_t i = 0; i < pieces.size(); i++)
+    {
+        Node<Key, Value>* n = pieces[i].first;
+        if(pieces[i].second)
+            pool.submit([f, n]() { walkSubtree(n, *f); });
+    }
+    for(size_t i = 0; i < pieces.size(); i++)
+    {
+        Node<Key, Value>* n = pieces[i].first;
+        if(!pieces[i].second && !n->isTombstone())
+            fn(n->getItem());
+    }
+    pool.wait();
+}
+
+/**
+* Folds the tree: combine(...combine(combine(init, map(first)),
+* map(second))..., map(last)) in key order, except that runs of
+* neighbouring items are folded on different threads and then combined.
+* So combine must be associative, but need not be commutative.
+* map and combine run concurrently and must be safe to call from several
+* threads. The tree must not change until this returns.
+*/
+template<class Key, class Value>
+template<class T, class Map, class Combine>
+T BinarySearchTree<Key, Value>::parallel_reduce(T init, Map map, Combine combine, unsigned threads) const
+{
+    TaskPool pool(threads);
+    return parallel_reduce(init, map, combine, pool);
+}
+
+/**
+* As above, on the caller's pool. Call from outside the pool; this waits
+* for everything submitted to it.
+*/
+template<class Key, class Value>
+template<class T, class Map, class Combine>
+T BinarySearchTree<Key, Value>::parallel_reduce(T init, Map map, Combine combine, TaskPool& pool) const
+{
+    std::vector<std::pair<Node<Key, Value>*, bool> > pieces;
+    splitForTasks(root_, parallelSplitDepth(pool.threads()), pieces);
+
+    // one partial result per piece
+    std::vector<ReducePartial<T> > partial(pieces.size(), ReducePartial<T>(init));
+    for(size_t i = 0; i < pieces.size(); i++)
+    {
+        if(!pieces[i].second)
+            continue;
+        Node<Key, Value>* n = pieces[i].first;
+        ReducePartial<T>* out = &partial[i];
+        Map* m = &map;
+        Combine* c = &combine;
+        pool.submit([n, out, m, c]() {
+            auto fold = [out, m, c](std::pair<const Key, Value>& item) {
+                if(out->filled)
+                    out->value = (*c)(out->value, (*m)(item));
+                else
+                {
+                    out->value = (*m)(item);
+                    out->filled = true;
+                }
+            };
+            walkSubtree(n, fold);
+        });
+    }
+    for(size_t i = 0; i < pieces.size(); i++)
+    {
+        Node<Key, Value>* n = pieces[i].first;
+        if(!pieces[i].second && !n->isTombstone())
+        {
+            partial[i].value = map(n->getItem());
+            partial[i].filled = true;
+        }
+    }
+    pool.wait();
+
+    T result = init;
+    for(size_t i = 0; i < pieces.size(); i++)
+    {
+        if(partial[i].filled)
+            result = combine(result, partial[i].value);
+    }
+    return result;
+}
+
+#endif
@@ -1,10 +1,34 @@
 #include <iostream>
 #include <map>
+#include <vector>
+#include <iterator>
+#include <string>
 #include "bst.h"
 #include "avlbst.h"
+#include "splaybst.h"
+#include "btree.h"
+#include "avlseq.h"
+#include "augavl.h"
+#include "interval-tree.h"
+#include "avlmulti.h"
+#include "avlset.h"
+#include "avlcompact.h"
 
 using namespace std;
 
+// A value big enough to keep out of the tree nodes (see value-storage.h)
+struct Reading
+{
+    double samples[16];
+};
+
+template<> struct ValueStorage<Reading> { static const bool outOfLine = true; };
+
+ostream& operator<<(ostream& out, const Reading& reading)
+{
+    return out << reading.samples[0];
+}
+
 
 int main(int argc, char *argv[])
 {
@@ -83,6 +107,228 @@ int main(int argc, char *argv[])
 
     at.print();
 
+    // Lazy deletion Tests
+    AVLTree<int,int> lt;
+    lt.setLazyDelete(true, 0.5);
+    for(int i = 0; i < 8; i++) {
+        lt.insert(std::make_pair(i, i * i));
+    }
+    lt.remove(2);
+    lt.remove(5);
+    cout << "\nAVLTree after lazy removes (" << lt.tombstones() << " tombstones):" << endl;
+    for(AVLTree<int,int>::iterator it = lt.begin(); it != lt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    lt.compact();
+    cout << "after compact: " << lt.size() << " items, " << lt.tombstones() << " tombstones" << endl;
+
+    // Priority index Tests
+    cout << "front " << lt.front().first << ", back " << lt.back().first << endl;
+    cout << "pop_min order:";
+    while(!lt.empty()) {
+        cout << " " << lt.pop_min().first;
+    }
+    cout << endl;
+
+    // Hinted insert Tests
+    AVLTree<int, int> ht;
+    AVLTree<int, int>::iterator hint = ht.end();
+    for(int i = 0; i < 8; i++) {
+        hint = ht.insert(ht.end(), std::make_pair(i * 10, i));
+    }
+    ht.insert(hint, std::make_pair(65, 0)); //hint: 70 comes right after 65
+    cout << "\nAVLTree after hinted inserts:" << endl;
+    ht.print();
+
+    // Splay Tree Tests
+    SplayTree<char,int> st;
+    st.insert(std::make_pair('c',3));
+    st.insert(std::make_pair('a',1));
+    st.insert(std::make_pair('b',2));
+    st.find('a');
+    cout << "\nSplayTree after finding a:" << endl;
+    st.print();
+    for(SplayTree<char,int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // B+-tree Tests
+    BTreeMap<int,int,16> bm;
+    for(int i = 0; i < 20; i++) {
+        bm.insert(std::make_pair((i * 7) % 20, i));
+    }
+    bm.remove(3);
+    bm.remove(10);
+    cout << "\nBTreeMap contents:" << endl;
+    for(BTreeMap<int,int,16>::iterator it = bm.begin(); it != bm.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Sequence Tests
+    AVLSequence<char> seq;
+    seq.push_back('a');
+    seq.push_back('d');
+    seq.insert_at(1, 'c');
+    seq.insert_at(1, 'b');
+    AVLSequence<char> tail;
+    seq.split_at(2, tail);
+    tail.concat(seq);
+    seq.concat(tail);
+    seq.erase_at(0);
+    cout << "\nAVLSequence contents:" << endl;
+    for(size_t i = 0; i < seq.size(); i++) {
+        cout << seq[i];
+    }
+    cout << endl;
+
+    // Range aggregate Tests
+    AugmentedAVLTree<int, int, SumMonoid<int> > sums;
+    for(int i = 1; i <= 10; i++) {
+        sums.insert(std::make_pair(i, i * i));
+    }
+    sums.update_value(3, 0);
+    sums.remove(4);
+    cout << "\nsum of squares over keys [2,5] (3 zeroed, 4 removed): " << sums.aggregate(2, 5) << endl;
+
+    // Interval Tests
+    IntervalTree<int, char> meetings;
+    meetings.insert(9, 10, 'a');
+    meetings.insert(9, 12, 'b');
+    meetings.insert(11, 13, 'c');
+    meetings.insert(14, 15, 'd');
+    std::vector<IntervalTree<int, char>::iterator> atEleven;
+    meetings.stabbing(11, std::back_inserter(atEleven));
+    cout << "\nintervals containing 11:";
+    for(size_t i = 0; i < atEleven.size(); i++) {
+        cout << " " << atEleven[i]->first << atEleven[i]->second;
+    }
+    cout << endl;
+
+    // Multimap Tests
+    AVLMultiMap<char, int> grades;
+    grades.insert(std::make_pair('b', 1));
+    grades.insert(std::make_pair('a', 2));
+    grades.insert(std::make_pair('b', 3));
+    grades.insert(std::make_pair('b', 4));
+    cout << "\nvalues for b (" << grades.count('b') << "):";
+    typedef AVLMultiMap<char, int>::iterator GradeIt;
+    for(std::pair<GradeIt, GradeIt> r = grades.equal_range('b'); r.first != r.second; ++r.first) {
+        cout << " " << r.first->second;
+    }
+    cout << endl;
+
+    // Set Tests
+    AVLSet<int> primes;
+    int candidates[] = {7, 2, 11, 5, 3, 7, 13};
+    for(int i = 0; i < 7; i++) {
+        primes.insert(candidates[i]);
+    }
+    primes.remove(13);
+    cout << "\nAVLSet contents (" << primes.size() << "):";
+    for(AVLSet<int>::iterator it = primes.begin(); it != primes.end(); ++it) {
+        cout << " " << *it;
+    }
+    cout << endl;
+
+    // Compact Tree Tests
+    CompactAVLTree<int, char> compact;
+    for(int i = 0; i < 8; i++) {
+        compact.insert(std::make_pair((i * 5) % 8, char('a' + i)));
+    }
+    compact.remove(3);
+    compact.remove(6);
+    cout << "\nCompactAVLTree contents (" << compact.size() << "):";
+    for(CompactAVLTree<int, char>::iterator it = compact.begin(); it != compact.end(); ++it) {
+        cout << " " << it->first << it->second;
+    }
+    cout << endl;
+
+    CompactAVLTree<int, char, LinkedNodes<int, char> > lean;
+    for(int i = 0; i < 8; i++) {
+        lean.insert(std::make_pair((i * 3) % 8, char('a' + i)));
+    }
+    lean.remove(0);
+    cout << "parent-free CompactAVLTree contents (" << lean.size() << "):";
+    for(CompactAVLTree<int, char, LinkedNodes<int, char> >::iterator it = lean.begin(); it != lean.end(); ++it) {
+        cout << " " << it->first << it->second;
+    }
+    cout << endl;
+
+    CompactAVLTree<int, std::string, SplitNodes<int, std::string> > split;
+    split.insert(std::make_pair(20, std::string("twenty")));
+    split.insert(std::make_pair(10, std::string("ten")));
+    split.insert(std::make_pair(30, std::string("thirty")));
+    cout << "SplitNodes keys from 15:";
+    for(CompactAVLTree<int, std::string, SplitNodes<int, std::string> >::iterator it = split.lower_bound(15); it != split.end(); ++it) {
+        cout << " " << it->first << "=" << it->second;
+    }
+    cout << endl;
+
+    // Threaded Tests
+    BinarySearchTree<int,int> tb;
+    AVLTree<int,int> ta;
+    tb.setThreaded(true);
+    ta.setThreaded(true);
+    for(int i = 0; i < 16; i++) {
+        tb.insert(std::make_pair((i * 7) % 16, i));
+        ta.insert(std::make_pair((i * 7) % 16, i));
+    }
+    for(int i = 0; i < 16; i += 3) {
+        tb.remove(i);
+        ta.remove(i);
+    }
+    cout << "\nthreaded pops: " << tb.pop_min().first << " " << tb.pop_max().first
+         << ", " << ta.pop_min().first << " " << ta.pop_max().first << endl;
+    tb.rebalance();
+    ta.rebalance();
+    cout << "threaded BST in order:";
+    for(BinarySearchTree<int,int>::iterator it = tb.begin(); it != tb.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << "\nthreaded AVLTree in order:";
+    for(AVLTree<int,int>::iterator it = ta.begin(); it != ta.end(); ++it) {
+        cout << " " << it->first;
+    }
+    cout << endl;
+
+    // Scapegoat Tests
+    BinarySearchTree<int,int> sg;
+    sg.setScapegoat(true, 0.7);
+    for(int i = 0; i < 1000; i++) {
+        sg.insert(std::make_pair(i, i));
+    }
+    cout << "\nscapegoat BST after 1000 sorted inserts: height " << sg.height()
+         << ", bound log_{1/0.7}(1000) = " << std::log(1000.0) / std::log(1 / 0.7) << endl;
+    for(int i = 0; i < 900; i++) {
+        sg.remove(i); //below 0.7 * 1000 items the whole tree is rebuilt
+    }
+    cout << "after removing 900: " << sg.size() << " items, height " << sg.height() << endl;
+
+    AVLTree<int,int> sgAvl;
+    try {
+        sgAvl.setScapegoat(true, 0.7);
+    }
+    catch(std::logic_error& e) {
+        cout << "AVLTree::setScapegoat: " << e.what() << endl;
+    }
+
+    // Value Storage Tests
+    AVLTree<int, Reading> readings;
+    Reading r = Reading();
+    for(int i = 0; i < 8; i++) {
+        r.samples[0] = i;
+        readings.insert(std::make_pair(i, r));
+    }
+    AVLTree<int, Reading>::iterator three = readings.find(3);
+    three->second.samples[0] = 30; //writes the pooled pair
+    Reading* pooled = &readings.at(3);
+    for(int i = 8; i < 64; i++) {
+        readings.insert(std::make_pair(i, r));
+    }
+    cout << "\nnode " << sizeof(AVLNode<int, Reading>) << " bytes for a " << sizeof(Reading)
+         << "-byte value; at(3) = " << readings.at(3).samples[0]
+         << ", same pair after more inserts: " << (&readings.find(3)->second == pooled) << endl;
+
     /*
     at.insert(std::make_pair('a',1));
     at.insert(std::make_pair('b',2));
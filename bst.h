@@ -3,9 +3,20 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
 #include <cstdlib>
+#include <cstdint>
 #include <utility>
 #include <cmath> 
+#include <vector>
+#include "value-storage.h"
+
+// Hint that p will be read soon; a no-op where the builtin is missing.
+#if defined(__GNUC__)
+#define BST_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define BST_PREFETCH(p) ((void)0)
+#endif
 
 /**
  * A templated class for a Node in a search tree.
@@ -17,7 +28,7 @@
 using namespace std;
 
 template <typename Key, typename Value>
-class Node
+class Node : protected NodeItem<Key, Value>
 {
 public:
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
@@ -32,14 +43,29 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    virtual bool isTombstone() const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
 
+    // Threads (see BinarySearchTree::setThreaded): a child slot with no
+    // child can hold the in-order neighbour instead, tagged in its low
+    // bit. getLeft/getRight never return threads; setLeft/setRight
+    // overwrite them.
+    bool hasLeftThread() const;
+    bool hasRightThread() const;
+    Node<Key, Value>* getLeftThread() const;
+    Node<Key, Value>* getRightThread() const;
+    void setLeftThread(Node<Key, Value>* pred);
+    void setRightThread(Node<Key, Value>* succ);
+
 protected:
-    std::pair<const Key, Value> item_;
+    static bool isThread(Node<Key, Value>* slot);
+    static Node<Key, Value>* thread(Node<Key, Value>* target);
+    static Node<Key, Value>* unthread(Node<Key, Value>* slot);
+
     Node<Key, Value>* parent_;
     Node<Key, Value>* left_;
     Node<Key, Value>* right_;
@@ -56,7 +82,7 @@ protected:
 */
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
-    item_(key, value),
+    NodeItem<Key, Value>(key, value),
     parent_(parent),
     left_(NULL),
     right_(NULL)
@@ -81,7 +107,7 @@ Node<Key, Value>::~Node()
 template<typename Key, typename Value>
 const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 {
-    return item_;
+    return this->item();
 }
 
 /**
@@ -90,7 +116,7 @@ const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 template<typename Key, typename Value>
 std::pair<const Key, Value>& Node<Key, Value>::getItem()
 {
-    return item_;
+    return this->item();
 }
 
 /**
@@ -99,7 +125,7 @@ std::pair<const Key, Value>& Node<Key, Value>::getItem()
 template<typename Key, typename Value>
 const Key& Node<Key, Value>::getKey() const
 {
-    return item_.first;
+    return this->key();
 }
 
 /**
@@ -108,7 +134,7 @@ const Key& Node<Key, Value>::getKey() const
 template<typename Key, typename Value>
 const Value& Node<Key, Value>::getValue() const
 {
-    return item_.second;
+    return this->item().second;
 }
 
 /**
@@ -117,7 +143,7 @@ const Value& Node<Key, Value>::getValue() const
 template<typename Key, typename Value>
 Value& Node<Key, Value>::getValue()
 {
-    return item_.second;
+    return this->item().second;
 }
 
 /**
@@ -135,7 +161,7 @@ Node<Key, Value>* Node<Key, Value>::getParent() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
 {
-    return left_;
+    return isThread(left_) ? NULL : left_;
 }
 
 /**
@@ -144,7 +170,18 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
 {
-    return right_;
+    return isThread(right_) ? NULL : right_;
+}
+
+/**
+* Plain nodes are never tombstones. Trees that delete lazily (see
+* AVLTree::setLazyDelete) override this so iteration and find skip
+* nodes that are logically removed.
+*/
+template<typename Key, typename Value>
+bool Node<Key, Value>::isTombstone() const
+{
+    return false;
 }
 
 /**
@@ -174,13 +211,72 @@ void Node<Key, Value>::setRight(Node<Key, Value>* right)
     right_ = right;
 }
 
+/**
+* Thread accessors. A thread to NULL (the smallest node's predecessor,
+* the largest node's successor) is still a thread, so hasLeftThread /
+* hasRightThread tell "no neighbour" apart from "not threaded".
+*/
+template<typename Key, typename Value>
+bool Node<Key, Value>::hasLeftThread() const
+{
+    return isThread(left_);
+}
+
+template<typename Key, typename Value>
+bool Node<Key, Value>::hasRightThread() const
+{
+    return isThread(right_);
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getLeftThread() const
+{
+    return isThread(left_) ? unthread(left_) : NULL;
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getRightThread() const
+{
+    return isThread(right_) ? unthread(right_) : NULL;
+}
+
+template<typename Key, typename Value>
+void Node<Key, Value>::setLeftThread(Node<Key, Value>* pred)
+{
+    left_ = thread(pred);
+}
+
+template<typename Key, typename Value>
+void Node<Key, Value>::setRightThread(Node<Key, Value>* succ)
+{
+    right_ = thread(succ);
+}
+
+template<typename Key, typename Value>
+bool Node<Key, Value>::isThread(Node<Key, Value>* slot)
+{
+    return (reinterpret_cast<uintptr_t>(slot) & 1) != 0;
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::thread(Node<Key, Value>* target)
+{
+    return reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(target) | 1);
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::unthread(Node<Key, Value>* slot)
+{
+    return reinterpret_cast<Node<Key, Value>*>(reinterpret_cast<uintptr_t>(slot) & ~uintptr_t(1));
+}
+
 /**
 * A setter for the value of a node.
 */
 template<typename Key, typename Value>
 void Node<Key, Value>::setValue(const Value& value)
 {
-    item_.second = value;
+    this->item().second = value;
 }
 
 /*
@@ -189,6 +285,8 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+class TaskPool;
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -200,10 +298,28 @@ public:
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    virtual void clear(); //TODO
     bool isBalanced() const; //TODO
+    int height() const;     // edges on the longest root-to-leaf path, -1 when empty
+    virtual void rebalance();
+    // Scapegoat mode: keeps the plain tree's depth O(log n) by rebuilding
+    // the subtree that got too deep, with no extra data in the nodes.
+    void setScapegoat(bool enabled, double alpha = 0.7);
+    bool scapegoat() const;
+    // Threaded mode: empty child slots point to the in-order neighbours,
+    // so stepping an iterator never climbs parent links.
+    virtual void setThreaded(bool enabled);
+    bool threaded() const;
     void print() const;
     bool empty() const;
+    size_t size() const;
+
+    // Smallest/largest items in O(1) from the cached extreme nodes.
+    // Throw std::out_of_range on an empty tree.
+    std::pair<const Key, Value>& front() const;
+    std::pair<const Key, Value>& back() const;
+    std::pair<Key, Value> pop_min();
+    std::pair<Key, Value> pop_max();
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -233,14 +349,39 @@ public:
 public:
     iterator begin() const;
     iterator end() const;
+    template<class Function>
+    void for_each(Function fn) const;
+    // Multi-threaded scans, defined in bst-parallel.h (build with -pthread).
+    // The TaskPool overloads reuse the caller's threads instead of
+    // starting and joining a pool on every call.
+    template<class Function>
+    void parallel_for_each(Function fn, unsigned threads = 0) const;
+    template<class Function>
+    void parallel_for_each(Function fn, TaskPool& pool) const;
+    template<class T, class Map, class Combine>
+    T parallel_reduce(T init, Map map, Combine combine, unsigned threads = 0) const;
+    template<class T, class Map, class Combine>
+    T parallel_reduce(T init, Map map, Combine combine, TaskPool& pool) const;
     iterator find(const Key& key) const;
+    template<class InputIt, class OutputIt>
+    OutputIt find_sorted(InputIt first, InputIt last, OutputIt out) const;
+    iterator insert(iterator hint, const std::pair<const Key, Value>& keyValuePair);
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
+    Value& at(const Key& key);
+    Value const & at(const Key& key) const;
+    Value* try_get(const Key& key);
+    Value const * try_get(const Key& key) const;
+    bool contains(const Key& key) const;
+    Value get_or(const Key& key, const Value& fallback) const;
+    Value& get_or_insert(const Key& key, const Value& value = Value());
 
 protected:
     // Mandatory helper functions
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    Node<Key, Value>* fingerFind(Node<Key, Value>*& finger, const Key& k) const;
     Node<Key, Value> *getSmallestNode() const;  // TODO
+    Node<Key, Value> *getLargestNode() const;
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
@@ -251,13 +392,42 @@ protected:
 
     // Add helper functions here
 		virtual void clearHelper(Node<Key, Value>* n);
+		virtual void removeNode(Node<Key, Value>* n);
+		Node<Key, Value>* findSlot(const Key& key, Node<Key, Value>*& parent, bool& asLeft) const;
+		virtual Node<Key, Value>* linkNew(Node<Key, Value>* parent, bool asLeft,
+			const std::pair<const Key, Value>& keyValuePair);
+		virtual void overwrite(Node<Key, Value>* n, const Value& value);
+		virtual bool balancesItself() const;
+		void cacheExtremes(Node<Key, Value>* n);
+		void uncacheExtremes(Node<Key, Value>* n);
 		int getPathLength(Node<Key, Value>* n) const;
+		void rotateLeft(Node<Key, Value>* n);
+		void rotateRight(Node<Key, Value>* n);
+		Node<Key, Value>* rebuild(Node<Key, Value>* top);
+		void scapegoatCheck(Node<Key, Value>* n);
+		static size_t countNodes(Node<Key, Value>* n);
+		static iterator iteratorAt(Node<Key, Value>* n);
+		static Node<Key, Value>* nodeAt(const iterator& it);
+		template<class Function>
+		static void walkSubtree(Node<Key, Value>* root, Function& fn);
+		static void splitForTasks(Node<Key, Value>* n, int depth,
+			std::vector<std::pair<Node<Key, Value>*, bool> >& pieces);
+		void threadLeaf(Node<Key, Value>* n, Node<Key, Value>* parent, bool asLeft);
+		void bridgeThreads(Node<Key, Value>* pred, Node<Key, Value>* succ);
 		bool isBalancedHelper(Node<Key, Value>* n) const;
 
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    size_t size_;   // number of (live) items
+    // Nodes holding the smallest and largest keys. They follow the nodes,
+    // not tree positions, so rotations and nodeSwap leave them valid; only
+    // inserting or unlinking a node can change them.
+    Node<Key, Value>* minNode_;
+    Node<Key, Value>* maxNode_;
+    double scapegoatAlpha_;  // 0 when scapegoat mode is off
+    size_t maxSize_;         // largest size_ since the last full rebuild
+    bool threaded_;
 };
 
 /*
@@ -355,7 +525,9 @@ typename BinarySearchTree<Key, Value>::iterator&
 BinarySearchTree<Key, Value>::iterator::operator++()
 {
     // TODO
-		current_ = successor(current_);
+		do {
+			current_ = successor(current_);
+		} while(current_ != NULL && current_->isTombstone());
 		/*
     Node<Key, Value>* next = current_;
     
@@ -430,6 +602,12 @@ template<class Key, class Value>
 BinarySearchTree<Key, Value>::BinarySearchTree() 
 {
   root_ = NULL;
+  size_ = 0;
+  minNode_ = NULL;
+  maxNode_ = NULL;
+  scapegoatAlpha_ = 0;
+  maxSize_ = 0;
+  threaded_ = false;
 }
 
 template<typename Key, typename Value>
@@ -444,7 +622,16 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 template<class Key, class Value>
 bool BinarySearchTree<Key, Value>::empty() const
 {
-    return root_ == NULL;
+    return size_ == 0;
+}
+
+/**
+ * Returns the number of items in the tree
+*/
+template<class Key, class Value>
+size_t BinarySearchTree<Key, Value>::size() const
+{
+    return size_;
 }
 
 template<typename Key, typename Value>
@@ -461,10 +648,69 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    Node<Key, Value>* smallest = getSmallestNode();
+    while(smallest != NULL && smallest->isTombstone())
+        smallest = successor(smallest);
+    BinarySearchTree<Key, Value>::iterator begin(smallest);
     return begin;
 }
 
+/**
+* Returns the item with the smallest key
+*/
+template<class Key, class Value>
+std::pair<const Key, Value>&
+BinarySearchTree<Key, Value>::front() const
+{
+    iterator it = begin();
+    if(it == end()) throw std::out_of_range("Empty tree");
+    return *it;
+}
+
+/**
+* Returns the item with the largest key
+*/
+template<class Key, class Value>
+std::pair<const Key, Value>&
+BinarySearchTree<Key, Value>::back() const
+{
+    Node<Key, Value>* largest = maxNode_;
+    while(largest != NULL && largest->isTombstone())
+        largest = predecessor(largest);
+    if(largest == NULL) throw std::out_of_range("Empty tree");
+    return largest->getItem();
+}
+
+/**
+* Removes and returns the item with the smallest key. The node is unlinked
+* directly, without searching for its key.
+*/
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::pop_min()
+{
+    //lazily removed nodes at the front are cleaned up on the way
+    while(minNode_ != NULL && minNode_->isTombstone())
+        removeNode(minNode_);
+    if(minNode_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(minNode_->getKey(), minNode_->getValue());
+    removeNode(minNode_);
+    return item;
+}
+
+/**
+* Removes and returns the item with the largest key.
+*/
+template<class Key, class Value>
+std::pair<Key, Value> BinarySearchTree<Key, Value>::pop_max()
+{
+    while(maxNode_ != NULL && maxNode_->isTombstone())
+        removeNode(maxNode_);
+    if(maxNode_ == NULL) throw std::out_of_range("Empty tree");
+    std::pair<Key, Value> item(maxNode_->getKey(), maxNode_->getValue());
+    removeNode(maxNode_);
+    return item;
+}
+
 /**
 * Returns an iterator whose value means INVALID
 */
@@ -485,10 +731,91 @@ typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::find(const Key & k) const
 {
     Node<Key, Value> *curr = internalFind(k);
+    if(curr != NULL && curr->isTombstone()) curr = NULL;
     BinarySearchTree<Key, Value>::iterator it(curr);
     return it;
 }
 
+/**
+* Lets derived trees hand out iterators to nodes they found themselves,
+* and take them back (nodeAt).
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::iteratorAt(Node<Key, Value>* n)
+{
+    return iterator(n);
+}
+
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::nodeAt(const iterator& it)
+{
+    return it.current_;
+}
+
+/**
+* Looks up every key in [first, last) and writes an iterator per key to
+* out (end() for a missing key). Each search starts from where the
+* previous one ended instead of the root, so k sorted keys cost
+* O(k log(n/k)) rather than O(k log n). Unsorted keys still give the
+* right answers, they just don't get faster.
+*/
+template<class Key, class Value>
+template<class InputIt, class OutputIt>
+OutputIt BinarySearchTree<Key, Value>::find_sorted(InputIt first, InputIt last, OutputIt out) const
+{
+    Node<Key, Value>* finger = root_;
+    for(; first != last; ++first)
+    {
+        Node<Key, Value>* curr = fingerFind(finger, *first);
+        if(curr != NULL && curr->isTombstone()) curr = NULL;
+        *out = iterator(curr);
+        ++out;
+    }
+    return out;
+}
+
+/**
+* Calls fn(item) for every item in key order. Faster than the iterator
+* for full scans: an explicit stack replaces the parent climbs, and each
+* node's right subtree is prefetched when the node is pushed, so by the
+* time the walk gets there it is usually already in cache. The stack
+* holds one node per level of the tree.
+*/
+template<class Key, class Value>
+template<class Function>
+void BinarySearchTree<Key, Value>::for_each(Function fn) const
+{
+    walkSubtree(root_, fn);
+}
+
+template<class Key, class Value>
+template<class Function>
+void BinarySearchTree<Key, Value>::walkSubtree(Node<Key, Value>* root, Function& fn)
+{
+    std::vector<Node<Key, Value>*> stack;
+    stack.reserve(64);
+    Node<Key, Value>* n = root;
+    while(true)
+    {
+        while(n != NULL)
+        {
+            stack.push_back(n);
+            Node<Key, Value>* right = n->getRight();
+            if(right != NULL)
+                BST_PREFETCH(right);
+            n = n->getLeft();
+        }
+        if(stack.empty())
+            return;
+        n = stack.back();
+        stack.pop_back();
+        if(!n->isTombstone())
+            fn(n->getItem());
+        n = n->getRight();
+    }
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -497,17 +824,85 @@ template<class Key, class Value>
 Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
 {
     Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
+    if(curr == NULL || curr->isTombstone()) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
 template<class Key, class Value>
 Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 {
     Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
+    if(curr == NULL || curr->isTombstone()) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
 
+/**
+* Same as operator[]: throws std::out_of_range if key is not in the tree.
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::at(const Key& key)
+{
+    return BinarySearchTree<Key, Value>::operator[](key);
+}
+template<class Key, class Value>
+Value const & BinarySearchTree<Key, Value>::at(const Key& key) const
+{
+    return BinarySearchTree<Key, Value>::operator[](key);
+}
+
+/**
+* Lookups that never throw, for callers where misses are common: a miss
+* costs one descent, the same as a hit.
+* try_get returns a pointer to the value, or NULL if key is not in the tree.
+*/
+template<class Key, class Value>
+Value* BinarySearchTree<Key, Value>::try_get(const Key& key)
+{
+    Node<Key, Value> *curr = internalFind(key);
+    if(curr == NULL || curr->isTombstone()) return NULL;
+    return &curr->getValue();
+}
+template<class Key, class Value>
+Value const * BinarySearchTree<Key, Value>::try_get(const Key& key) const
+{
+    Node<Key, Value> *curr = internalFind(key);
+    if(curr == NULL || curr->isTombstone()) return NULL;
+    return &curr->getValue();
+}
+
+template<class Key, class Value>
+bool BinarySearchTree<Key, Value>::contains(const Key& key) const
+{
+    return try_get(key) != NULL;
+}
+
+/**
+* Returns a copy of the value for key, or fallback if key is not in the tree.
+*/
+template<class Key, class Value>
+Value BinarySearchTree<Key, Value>::get_or(const Key& key, const Value& fallback) const
+{
+    Value const * value = try_get(key);
+    return value != NULL ? *value : fallback;
+}
+
+/**
+* std::map::operator[] semantics: returns the value for key, first
+* inserting (key, value) if key is not in the tree. The lookup and the
+* insert share one descent.
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::get_or_insert(const Key& key, const Value& value)
+{
+    Node<Key, Value>* parent = NULL;
+    bool asLeft = false;
+    Node<Key, Value>* existing = findSlot(key, parent, asLeft);
+    if(existing == NULL)
+        return linkNew(parent, asLeft, std::make_pair(key, value))->getValue();
+    if(existing->isTombstone())
+        overwrite(existing, value);
+    return existing->getValue();
+}
+
 /**
 * An insert method to insert into a Binary Search Tree.
 * The tree will not remain balanced when inserting.
@@ -517,50 +912,162 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
-	Key key = keyValuePair.first;
-  Node<Key, Value>* next = internalFind(key);
-	if(next != NULL)
-		next->setValue(keyValuePair.second);
+	Node<Key, Value>* parent = NULL;
+	bool asLeft = false;
+	Node<Key, Value>* existing = findSlot(keyValuePair.first, parent, asLeft);
+	if(existing != NULL)
+		overwrite(existing, keyValuePair.second);
+	else
+		linkNew(parent, asLeft, keyValuePair);
+}
+
+/**
+* Inserts using hint, an iterator to the item that should come right after
+* the new one (end() to append). If the hint is right it is checked against
+* its neighbours and the node is linked there without searching from the
+* root; otherwise this is a normal insert. Returns an iterator to the item.
+* The check is O(1) for end(), begin() and, on threaded trees, a hint
+* whose left slot is free; otherwise finding the hint's predecessor walks
+* up to O(height). A hint the key is not before is rejected in O(1).
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &keyValuePair)
+{
+	const Key& key = keyValuePair.first;
+	Node<Key, Value>* next = hint.current_;
+
+	Node<Key, Value>* parent = NULL;
+	bool asLeft = false;
+	Node<Key, Value>* existing = NULL;
+	bool fits = false;
+
+	if(next != NULL && !(key < next->getKey()))
+	{
+		if(!(next->getKey() < key))
+			existing = next;
+	}
 	else
 	{
-		//dynamically allocate a new Node with inputted key/value
-		Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
-		//cout << "adding key " << key << endl;
-		if(root_ == NULL){
-			root_ = newNode;
+		//only now look for the item before the hint
+		Node<Key, Value>* prev;
+		if(next == NULL)
+			prev = maxNode_;
+		else if(next == minNode_)
+			prev = NULL;
+		else
+			prev = predecessor(next); //a thread hop, or a walk
+		if(prev == NULL || prev->getKey() < key)
+		{
+			//the hint is right: the new node goes between prev and next, and
+			//one of them has a free slot on the facing side
+			fits = true;
+			if(next != NULL && next->getLeft() == NULL)
+			{
+				parent = next;
+				asLeft = true;
+			}
+			else
+				parent = prev; //prev is next's predecessor, so its right is free
 		}
-		else{
-			//start at the top of the tree
-			next = root_;
-			while(next != NULL)
+		else if(!(key < prev->getKey()))
+			existing = prev;
+	}
+	if(existing == NULL && !fits)
+		existing = findSlot(key, parent, asLeft);
+
+	if(existing != NULL)
+	{
+		overwrite(existing, keyValuePair.second);
+		return iterator(existing);
+	}
+	return iterator(linkNew(parent, asLeft, keyValuePair));
+}
+
+/**
+* One descent that finds either the node holding key (returned) or the
+* empty slot where key belongs (returns NULL; parent and asLeft describe
+* the slot, parent is NULL for an empty tree). Keys beyond the current
+* largest or smallest key attach to the cached extreme node right away,
+* so sorted and nearly sorted input skips the descent entirely.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findSlot(const Key& key, Node<Key, Value>*& parent, bool& asLeft) const
+{
+	parent = NULL;
+	asLeft = false;
+	if(root_ == NULL)
+		return NULL;
+	if(maxNode_->getKey() < key) //append
+	{
+		parent = maxNode_;
+		return NULL;
+	}
+	if(key < minNode_->getKey()) //prepend
+	{
+		parent = minNode_;
+		asLeft = true;
+		return NULL;
+	}
+
+	Node<Key, Value>* next = root_;
+	while(true)
+	{
+		if(next->getKey() == key)
+			return next;
+		parent = next;
+		if(key > next->getKey()) //go to the right
+		{
+			next = next->getRight();
+			if(next == NULL) //if there's an empty spot
+				return NULL;
+		}
+		else //go to the left
+		{
+			next = next->getLeft();
+			if(next == NULL) //if there's an empty spot
 			{
-				if(key > next->getKey()) //go to the right
-				{
-					//cout << "at node " << next->getKey() << ", going right" << endl;
-					if(next->getRight() == NULL) //if there's an empty spot
-					{
-						newNode->setParent(next);
-						next->setRight(newNode);
-						break;
-					}
-					next = next->getRight();
-				}
-				else //go to the left
-				{
-					//cout << "at node " << next->getKey() << ", going left" << endl;
-					if(next->getLeft() == NULL) //if there's an empty spot
-					{
-						//cout << "theres an empty spot" << endl;
-						newNode->setParent(next);
-						next->setLeft(newNode);
-						break;
-					}
-					next = next->getLeft();
-				}
+				asLeft = true;
+				return NULL;
 			}
 		}
 	}
-	//cout << "done" << endl;
+}
+
+/**
+* Allocates a node for keyValuePair and links it into the empty slot
+* found by findSlot. Derived trees override this to use their own node
+* type and rebalance.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::linkNew(Node<Key, Value>* parent, bool asLeft,
+	const std::pair<const Key, Value> &keyValuePair)
+{
+	//dynamically allocate a new Node with inputted key/value
+	Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+	size_++;
+	cacheExtremes(newNode);
+	if(threaded_)
+		threadLeaf(newNode, parent, asLeft);
+	if(parent == NULL)
+		root_ = newNode;
+	else if(asLeft)
+		parent->setLeft(newNode);
+	else
+		parent->setRight(newNode);
+	if(scapegoatAlpha_ > 0)
+		scapegoatCheck(newNode);
+	return newNode;
+}
+
+/**
+* Recall: If key is already in the tree, you should
+* overwrite the current value with the updated value.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::overwrite(Node<Key, Value>* n, const Value& value)
+{
+	n->setValue(value);
 }
 
 
@@ -577,10 +1084,30 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
 		if(rmvNode == NULL)
 			return;
+		removeNode(rmvNode);
+}
+
+/**
+* Unlinks and frees the given node.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* rmvNode)
+{
+		uncacheExtremes(rmvNode);
+
+		//in threaded mode, the in-order neighbours whose threads need
+		//fixing once rmvNode is gone
+		Node<Key, Value>* before = threaded_ ? predecessor(rmvNode) : NULL;
+		Node<Key, Value>* after = threaded_ ? successor(rmvNode) : NULL;
+		bool swapped = false;
+		Node<Key, Value>* beforePred = NULL;
 
 		if(rmvNode->getLeft() != NULL && rmvNode->getRight() != NULL) //if node has both children
 		{
 			Node<Key, Value>* pred = predecessor(rmvNode);
+			if(threaded_)
+				beforePred = predecessor(pred);
+			swapped = true;
 			nodeSwap(pred, rmvNode);
 			if(root_ == rmvNode)
 				root_ = pred;
@@ -633,6 +1160,20 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 	
 
 		delete rmvNode;
+		size_--;
+		if(threaded_)
+		{
+			bridgeThreads(before, after);
+			if(swapped) //pred moved up; the slot it left may have emptied
+				bridgeThreads(beforePred, before);
+		}
+
+		//scapegoat mode: rebuild everything once enough items are gone
+		if(scapegoatAlpha_ > 0 && size_ < scapegoatAlpha_ * maxSize_)
+		{
+			rebuild(root_);
+			maxSize_ = size_;
+		}
 }
 
 
@@ -721,73 +1262,54 @@ Node<Key, Value>*
 BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
 {
 	Node<Key, Value>* next = current;
-    
-    if(next != NULL)
-    {
-        if(next->getRight() != NULL)
-        {
-            next = next->getRight();
-            while(next->getLeft() != NULL){
-                next = next->getLeft();
-						}
-            return next;   
-        }
-        else if(next->getParent() != NULL)
-        {
-            next = next->getParent();
-            while(next->getParent() != NULL)
-            {
-                if(next->getParent()->getLeft() == next)
-                {
-                    return next->getParent();
-                    break;
-                }
-                next = next->getParent();
-            }
-						if(current->getParent() == next)
-							return NULL;
-        }
-			}
-			return NULL;
-}
-
 
+	if(next == NULL)
+		return NULL;
+	if(next->getRight() != NULL) //leftmost node of the right subtree
+	{
+		next = next->getRight();
+		while(next->getLeft() != NULL)
+			next = next->getLeft();
+		return next;
+	}
+	if(next->hasRightThread()) //threaded: one hop
+		return next->getRightThread();
+	//otherwise climb until we come up from a left child
+	Node<Key, Value>* parent = next->getParent();
+	while(parent != NULL && parent->getRight() == next)
+	{
+		next = parent;
+		parent = parent->getParent();
+	}
+	return parent;
+}
 
 
 template<class Key, class Value>
 Node<Key, Value>*
 BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
 {
-  // TODO
-    Node<Key, Value>* next = current;
-    
-    if(next != NULL)
-    {
-        if(next->getLeft() != NULL)
-        {
-            next = next->getLeft();
-            while(next->getRight() != NULL){
-                next = next->getRight();
-						}
-            return next;   
-        }
-        else if(next->getParent() != NULL)
-        {
-            next = next->getParent();
-            while(next->getParent() != NULL)
-            {
-                if(next->getParent()->getRight() == next)
-                {
-                    return next->getParent();
-                    break;
-                }
-                next = next->getParent();
-            }
-						if(current->getParent() == next)
-							return NULL;
-        }
-			}
-			return NULL;
+	Node<Key, Value>* next = current;
+
+	if(next == NULL)
+		return NULL;
+	if(next->getLeft() != NULL) //rightmost node of the left subtree
+	{
+		next = next->getLeft();
+		while(next->getRight() != NULL)
+			next = next->getRight();
+		return next;
+	}
+	if(next->hasLeftThread()) //threaded: one hop
+		return next->getLeftThread();
+	//otherwise climb until we come up from a right child
+	Node<Key, Value>* parent = next->getParent();
+	while(parent != NULL && parent->getLeft() == next)
+	{
+		next = parent;
+		parent = parent->getParent();
+	}
+	return parent;
 }
 
 
@@ -800,7 +1322,10 @@ void BinarySearchTree<Key, Value>::clear()
 {
 		clearHelper(root_);
 		root_ = NULL;
-		
+		size_ = 0;
+		minNode_ = NULL;
+		maxNode_ = NULL;
+		maxSize_ = 0;
 }
 
 template<typename Key, typename Value>
@@ -829,16 +1354,43 @@ template<typename Key, typename Value>
 Node<Key, Value>*
 BinarySearchTree<Key, Value>::getSmallestNode() const
 {
-    Node<Key, Value>* next = root_;
+		return minNode_;
+}
 
-		if(root_ == NULL)
-			return NULL;
+/**
+* A helper function to find the largest node in the tree.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>*
+BinarySearchTree<Key, Value>::getLargestNode() const
+{
+		return maxNode_;
+}
 
-		while(next->getLeft() != NULL)
-		{
-			next = next->getLeft();
-		}
-		return next; 
+/**
+* Updates the cached extreme nodes for a node that was just linked in.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::cacheExtremes(Node<Key, Value>* n)
+{
+		if(minNode_ == NULL || n->getKey() < minNode_->getKey())
+			minNode_ = n;
+		if(maxNode_ == NULL || maxNode_->getKey() < n->getKey())
+			maxNode_ = n;
+}
+
+/**
+* Updates the cached extreme nodes for a node about to be unlinked. Must
+* run before the tree changes, while n's neighbours can still be found.
+* The extremes have at most one child, so this is O(1) amortized.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::uncacheExtremes(Node<Key, Value>* n)
+{
+		if(n == minNode_)
+			minNode_ = successor(n);
+		if(n == maxNode_)
+			maxNode_ = predecessor(n);
 }
 
 /**
@@ -866,6 +1418,336 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
     
 }
 
+/**
+* internalFind starting at finger, the last node a previous search
+* visited. Climbs only until the subtree is known to hold key, then
+* descends. Since finger's subtree always contains finger's key, only the
+* bound on key's side needs checking: that bound is the parent we leave
+* from the facing side. finger is updated to the last node visited.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::fingerFind(Node<Key, Value>*& finger, const Key& key) const
+{
+    Node<Key, Value>* next = finger;
+    if(next == NULL)
+        return NULL;
+    bool up = next->getKey() < key;
+    while(next->getParent() != NULL)
+    {
+        Node<Key, Value>* parent = next->getParent();
+        bool fromFacingSide = up ? (parent->getLeft() == next) : (parent->getRight() == next);
+        if(fromFacingSide)
+        {
+            if(up ? key < parent->getKey() : parent->getKey() < key)
+                break; //key is inside next's subtree
+            if(!(key < parent->getKey()) && !(parent->getKey() < key))
+            {
+                finger = parent;
+                return parent;
+            }
+        }
+        next = parent;
+    }
+
+    while(true)
+    {
+        finger = next;
+        if(next->getKey() == key)
+            return next;
+        Node<Key, Value>* child = (key > next->getKey()) ? next->getRight() : next->getLeft();
+        if(child == NULL)
+            return NULL;
+        next = child;
+    }
+}
+
+/**
+* Rebuilds the whole tree into a complete one (every level full except
+* possibly the last), restoring O(log n) lookups after sorted loads.
+* O(n) time, O(1) extra memory: nodes are only relinked, never copied.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebalance()
+{
+    rebuild(root_);
+}
+
+/**
+* Day-Stout-Warren rebuild of the subtree rooted at top; returns its new
+* root, which takes top's place under top's parent.
+* Right rotations first flatten the subtree into a "vine" (a sorted chain
+* of right children), then rounds of left rotations on every other vine
+* node halve the vine each time until the subtree is complete.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::rebuild(Node<Key, Value>* top)
+{
+    if(top == NULL)
+        return NULL;
+    Node<Key, Value>* parent = top->getParent();
+    bool isLeft = (parent != NULL && parent->getLeft() == top);
+
+    //tree to vine, counting the nodes on the way
+    size_t count = 0;
+    Node<Key, Value>* n = top;
+    while(n != NULL)
+    {
+        if(n->getLeft() != NULL)
+        {
+            rotateRight(n);
+            n = n->getParent();
+        }
+        else
+        {
+            count++;
+            n = n->getRight();
+        }
+    }
+
+    //vine to tree: the first round only folds the nodes that don't fit
+    //in the largest perfect tree, so the bottom level ends up left-packed
+    size_t perfect = 1;
+    while(perfect * 2 + 1 <= count)
+        perfect = perfect * 2 + 1;
+    for(size_t rotations = count - perfect; ; rotations = perfect)
+    {
+        n = (parent == NULL) ? root_ : (isLeft ? parent->getLeft() : parent->getRight());
+        for(size_t i = 0; i < rotations; i++)
+        {
+            rotateLeft(n);
+            n = n->getParent()->getRight();
+        }
+        if(perfect <= 1)
+            break;
+        perfect /= 2;
+    }
+    return (parent == NULL) ? root_ : (isLeft ? parent->getLeft() : parent->getRight());
+}
+
+/**
+* Turns threaded mode on or off, threading or unthreading every node in
+* one in-order pass. While on, every empty left slot holds a thread to
+* the node's predecessor and every empty right slot one to its successor,
+* and insert, remove and rotations keep them current, so iterator++ is
+* one pointer hop whenever a node has no right child. Costs no memory:
+* the threads live in the otherwise NULL child pointers.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setThreaded(bool enabled)
+{
+    if(enabled == threaded_)
+        return;
+    Node<Key, Value>* prev = NULL;
+    Node<Key, Value>* n = minNode_;
+    while(n != NULL)
+    {
+        Node<Key, Value>* next = successor(n);
+        if(n->getLeft() == NULL)
+        {
+            if(enabled) n->setLeftThread(prev);
+            else n->setLeft(NULL);
+        }
+        if(n->getRight() == NULL)
+        {
+            if(enabled) n->setRightThread(next);
+            else n->setRight(NULL);
+        }
+        prev = n;
+        n = next;
+    }
+    threaded_ = enabled;
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::threaded() const
+{
+    return threaded_;
+}
+
+/**
+* Gives n, about to be linked as parent's asLeft child, its threads: the
+* neighbour on the far side is the thread parent had on that side, and
+* the one on the near side is parent itself.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::threadLeaf(Node<Key, Value>* n, Node<Key, Value>* parent, bool asLeft)
+{
+    if(parent == NULL)
+    {
+        n->setLeftThread(NULL);
+        n->setRightThread(NULL);
+    }
+    else if(asLeft)
+    {
+        n->setLeftThread(parent->getLeftThread());
+        n->setRightThread(parent);
+    }
+    else
+    {
+        n->setLeftThread(parent);
+        n->setRightThread(parent->getRightThread());
+    }
+}
+
+/**
+* After unlinking the node between pred and succ, threads that pointed at
+* it (and the slot its parent lost) now point across the gap.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::bridgeThreads(Node<Key, Value>* pred, Node<Key, Value>* succ)
+{
+    if(pred != NULL && pred->getRight() == NULL)
+        pred->setRightThread(succ);
+    if(succ != NULL && succ->getLeft() == NULL)
+        succ->setLeftThread(pred);
+}
+
+/**
+* Turns scapegoat mode on or off. alpha (between 0.5 and 1) is how
+* lopsided a subtree may get: no child may hold more than alpha of its
+* parent's nodes once the tree is too deep. Smaller alpha means shallower
+* trees and more rebuilding. Turning the mode on rebuilds the tree once.
+* Only the plain BinarySearchTree uses it: trees that balance themselves
+* (balancesItself()) throw std::logic_error, since a rebuild would leave
+* their per-node balance data stale.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setScapegoat(bool enabled, double alpha)
+{
+    if(!enabled)
+    {
+        scapegoatAlpha_ = 0;
+        return;
+    }
+    if(alpha <= 0.5 || alpha >= 1)
+        throw std::invalid_argument("Scapegoat alpha must be between 0.5 and 1");
+    if(balancesItself())
+        throw std::logic_error("Scapegoat mode is only for trees that do not balance themselves");
+    scapegoatAlpha_ = alpha;
+    rebuild(root_);
+    maxSize_ = size_;
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::scapegoat() const
+{
+    return scapegoatAlpha_ > 0;
+}
+
+/**
+* Called after linking the new leaf n. If n ended up deeper than
+* log_{1/alpha}(size), climbs to the first ancestor whose child on n's
+* side is too heavy (the scapegoat) and rebuilds that subtree. Subtree
+* sizes are counted on the way up, so the climb costs about as much as
+* the rebuild, which is linear in the scapegoat's size.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::scapegoatCheck(Node<Key, Value>* n)
+{
+    if(size_ > maxSize_)
+        maxSize_ = size_;
+    int depth = 0;
+    for(Node<Key, Value>* up = n->getParent(); up != NULL; up = up->getParent())
+        depth++;
+    if(depth <= std::log(double(size_)) / std::log(1.0 / scapegoatAlpha_))
+        return;
+
+    size_t childSize = 1;
+    while(n->getParent() != NULL)
+    {
+        Node<Key, Value>* parent = n->getParent();
+        Node<Key, Value>* sibling = (parent->getLeft() == n) ? parent->getRight() : parent->getLeft();
+        size_t parentSize = childSize + 1 + countNodes(sibling);
+        if(childSize > scapegoatAlpha_ * parentSize)
+        {
+            rebuild(parent);
+            return;
+        }
+        n = parent;
+        childSize = parentSize;
+    }
+}
+
+/**
+* Size of the subtree rooted at n. Iterative: the subtrees counted here
+* are the ones that got too deep.
+*/
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::countNodes(Node<Key, Value>* n)
+{
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> pending;
+    if(n != NULL)
+        pending.push_back(n);
+    while(!pending.empty())
+    {
+        n = pending.back();
+        pending.pop_back();
+        count++;
+        if(n->getLeft() != NULL)
+            pending.push_back(n->getLeft());
+        if(n->getRight() != NULL)
+            pending.push_back(n->getRight());
+    }
+    return count;
+}
+
+/**
+* Whether the tree keeps itself balanced with data of its own (AVLTree's
+* balances), which scapegoat rebuilds would not maintain.
+*/
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::balancesItself() const
+{
+    return false;
+}
+
+/**
+* Rotations around n that keep parent links and root_ up to date.
+* rotateLeft moves n's right child up into n's place; rotateRight the left.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateLeft(Node<Key, Value>* n)
+{
+    Node<Key, Value>* up = n->getRight();
+    Node<Key, Value>* parent = n->getParent();
+    n->setRight(up->getLeft());
+    if(up->getLeft() != NULL)
+        up->getLeft()->setParent(n);
+    else if(threaded_)
+        n->setRightThread(up);
+    up->setLeft(n);
+    up->setParent(parent);
+    n->setParent(up);
+    if(parent == NULL)
+        root_ = up;
+    else if(parent->getLeft() == n)
+        parent->setLeft(up);
+    else
+        parent->setRight(up);
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateRight(Node<Key, Value>* n)
+{
+    Node<Key, Value>* up = n->getLeft();
+    Node<Key, Value>* parent = n->getParent();
+    n->setLeft(up->getRight());
+    if(up->getRight() != NULL)
+        up->getRight()->setParent(n);
+    else if(threaded_)
+        n->setLeftThread(up);
+    up->setRight(n);
+    up->setParent(parent);
+    n->setParent(up);
+    if(parent == NULL)
+        root_ = up;
+    else if(parent->getLeft() == n)
+        parent->setLeft(up);
+    else
+        parent->setRight(up);
+}
+
 /**
  * Return true iff the BST is balanced.
  */
@@ -877,6 +1759,14 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
     return isBalancedHelper(root_);
 }
 
+template<typename Key, typename Value>
+int BinarySearchTree<Key, Value>::height() const
+{
+    if(root_ == NULL)
+        return -1;
+    return getPathLength(root_);
+}
+
 template<typename Key, typename Value>
 bool BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key, Value>* n) const
 {
@@ -1015,6 +1905,9 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 // include print function (in its own file because it's fairly long)
 #include "print_bst.h"
 
+// multi-threaded traversals
+#include "bst-parallel.h"
+
 /*
 ---------------------------------------------------
 End implementations for the BinarySearchTree class.
@@ -0,0 +1,269 @@
+#ifndef BTREE_SIMD_H
+#define BTREE_SIMD_H
+
+// SIMD versions of BTreeSearch for plain integer and floating point keys.
+// Included at the bottom of btree.h.
+//
+// The instruction set is picked once at startup with CPUID, so one binary
+// runs everywhere: AVX2 (4 x 64-bit / 8 x 32-bit / 32 x 8-bit keys per
+// compare), SSE4.2 (half of that), or the plain loop from btree.h.
+// Each search compares the key against a whole vector of node keys, turns
+// the comparison into a bit mask and counts the bits, so picking the child
+// index has no data-dependent branches.
+// Build with -DBTREE_NO_SIMD to always use the plain loop.
+
+#include <type_traits>
+#include <cstdint>
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_SSE4 = 1, SIMD_AVX2 = 2 };
+
+#if !defined(BTREE_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BTREE_SIMD 1
+#include <immintrin.h>
+#endif
+
+/**
+* Best instruction set this CPU supports.
+*/
+inline SimdLevel detectSimdLevel()
+{
+#ifdef BTREE_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if(__builtin_cpu_supports("sse4.2"))
+        return SIMD_SSE4;
+#endif
+    return SIMD_SCALAR;
+}
+
+// Holds the level in use. A template so the definition can live in a header.
+template <typename Dummy = void>
+struct SimdDispatch
+{
+    static SimdLevel level;
+};
+template <typename Dummy>
+SimdLevel SimdDispatch<Dummy>::level = detectSimdLevel();
+
+inline SimdLevel getSimdLevel()
+{
+    return SimdDispatch<>::level;
+}
+
+/**
+* Forces a lower instruction set (for benchmarks and tests). Returns false,
+* changing nothing, if the CPU does not support the requested level.
+*/
+inline bool setSimdLevel(SimdLevel level)
+{
+    if(level > detectSimdLevel())
+        return false;
+    SimdDispatch<>::level = level;
+    return true;
+}
+
+#ifdef BTREE_SIMD
+
+/**
+* Per key type vector operations. Unsigned integers are shifted into signed
+* range by flipping the sign bit, since SSE/AVX2 only compare signed lanes.
+* All masks are byte masks, so a matching lane sets sizeof(Key) bits.
+*/
+template <typename Key, typename Enable = void>
+struct SimdKeyOps
+{
+    static const bool supported = false;
+};
+
+template <typename Key>
+struct SimdKeyOps<Key, typename std::enable_if<std::is_integral<Key>::value &&
+    !std::is_same<Key, bool>::value>::type>
+{
+    static const bool supported = true;
+    typedef typename std::make_signed<Key>::type Signed;
+    typedef typename std::make_unsigned<Key>::type Unsigned;
+
+    static Signed bias(Key k)
+    {
+        if(std::is_signed<Key>::value)
+            return Signed(k);
+        return Signed(Unsigned(k) ^ Unsigned(Unsigned(1) << (sizeof(Key) * 8 - 1)));
+    }
+
+    __attribute__((target("sse4.2"))) static __m128i set128(Signed v) { return set128(v, v); }
+    __attribute__((target("sse4.2"))) static __m128i set128(int8_t v, int8_t) { return _mm_set1_epi8(v); }
+    __attribute__((target("sse4.2"))) static __m128i set128(int16_t v, int16_t) { return _mm_set1_epi16(v); }
+    __attribute__((target("sse4.2"))) static __m128i set128(int32_t v, int32_t) { return _mm_set1_epi32(v); }
+    __attribute__((target("sse4.2"))) static __m128i set128(long long v, long long) { return _mm_set1_epi64x(v); }
+    __attribute__((target("sse4.2"))) static __m128i set128(long v, long) { return _mm_set1_epi64x(v); }
+
+    __attribute__((target("sse4.2"))) static __m128i load128(const Key* p)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if(std::is_signed<Key>::value)
+            return v;
+        return _mm_xor_si128(v, set128(bias(Key(0))));
+    }
+
+    // byte mask of lanes where a > b
+    __attribute__((target("sse4.2"))) static int gt128(__m128i a, __m128i b)
+    {
+        if(sizeof(Key) == 1) return _mm_movemask_epi8(_mm_cmpgt_epi8(a, b));
+        if(sizeof(Key) == 2) return _mm_movemask_epi8(_mm_cmpgt_epi16(a, b));
+        if(sizeof(Key) == 4) return _mm_movemask_epi8(_mm_cmpgt_epi32(a, b));
+        return _mm_movemask_epi8(_mm_cmpgt_epi64(a, b));
+    }
+
+    __attribute__((target("avx2"))) static __m256i set256(Signed v) { return set256(v, v); }
+    __attribute__((target("avx2"))) static __m256i set256(int8_t v, int8_t) { return _mm256_set1_epi8(v); }
+    __attribute__((target("avx2"))) static __m256i set256(int16_t v, int16_t) { return _mm256_set1_epi16(v); }
+    __attribute__((target("avx2"))) static __m256i set256(int32_t v, int32_t) { return _mm256_set1_epi32(v); }
+    __attribute__((target("avx2"))) static __m256i set256(long long v, long long) { return _mm256_set1_epi64x(v); }
+    __attribute__((target("avx2"))) static __m256i set256(long v, long) { return _mm256_set1_epi64x(v); }
+
+    __attribute__((target("avx2"))) static __m256i load256(const Key* p)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        if(std::is_signed<Key>::value)
+            return v;
+        return _mm256_xor_si256(v, set256(bias(Key(0))));
+    }
+
+    __attribute__((target("avx2"))) static unsigned gt256(__m256i a, __m256i b)
+    {
+        if(sizeof(Key) == 1) return unsigned(_mm256_movemask_epi8(_mm256_cmpgt_epi8(a, b)));
+        if(sizeof(Key) == 2) return unsigned(_mm256_movemask_epi8(_mm256_cmpgt_epi16(a, b)));
+        if(sizeof(Key) == 4) return unsigned(_mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b)));
+        return unsigned(_mm256_movemask_epi8(_mm256_cmpgt_epi64(a, b)));
+    }
+};
+
+template <typename Key>
+struct SimdKeyOps<Key, typename std::enable_if<std::is_floating_point<Key>::value &&
+    (sizeof(Key) == 4 || sizeof(Key) == 8)>::type>
+{
+    static const bool supported = true;
+    typedef Key Signed;
+
+    static Key bias(Key k) { return k; }
+
+    __attribute__((target("sse4.2"))) static __m128i set128(Key v)
+    {
+        if(sizeof(Key) == 4) return _mm_castps_si128(_mm_set1_ps(float(v)));
+        return _mm_castpd_si128(_mm_set1_pd(double(v)));
+    }
+    __attribute__((target("sse4.2"))) static __m128i load128(const Key* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    __attribute__((target("sse4.2"))) static int gt128(__m128i a, __m128i b)
+    {
+        if(sizeof(Key) == 4)
+            return _mm_movemask_epi8(_mm_castps_si128(_mm_cmpgt_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))));
+        return _mm_movemask_epi8(_mm_castpd_si128(_mm_cmpgt_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))));
+    }
+
+    __attribute__((target("avx2"))) static __m256i set256(Key v)
+    {
+        if(sizeof(Key) == 4) return _mm256_castps_si256(_mm256_set1_ps(float(v)));
+        return _mm256_castpd_si256(_mm256_set1_pd(double(v)));
+    }
+    __attribute__((target("avx2"))) static __m256i load256(const Key* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    __attribute__((target("avx2"))) static unsigned gt256(__m256i a, __m256i b)
+    {
+        if(sizeof(Key) == 4)
+            return unsigned(_mm256_movemask_epi8(_mm256_castps_si256(
+                _mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_GT_OQ))));
+        return unsigned(_mm256_movemask_epi8(_mm256_castpd_si256(
+            _mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_GT_OQ))));
+    }
+};
+
+/**
+* Counts keys[i] < key (KeysGreater = false) or keys[i] > key
+* (KeysGreater = true) over count keys.
+*/
+template <typename Key, bool KeysGreater>
+struct SimdCount
+{
+    typedef SimdKeyOps<Key> Ops;
+
+    __attribute__((target("sse4.2"))) static int sse4(const Key* keys, int count, const Key& key)
+    {
+        const int lanes = 16 / sizeof(Key);
+        __m128i k = Ops::set128(Ops::bias(key));
+        int bits = 0;
+        int i = 0;
+        for(; i + lanes <= count; i += lanes)
+        {
+            __m128i v = Ops::load128(keys + i);
+            bits += __builtin_popcount(KeysGreater ? Ops::gt128(v, k) : Ops::gt128(k, v));
+        }
+        int idx = bits / int(sizeof(Key));
+        for(; i < count; i++)
+            idx += KeysGreater ? (key < keys[i]) : (keys[i] < key);
+        return idx;
+    }
+
+    __attribute__((target("avx2"))) static int avx2(const Key* keys, int count, const Key& key)
+    {
+        const int lanes = 32 / sizeof(Key);
+        __m256i k = Ops::set256(Ops::bias(key));
+        int bits = 0;
+        int i = 0;
+        for(; i + lanes <= count; i += lanes)
+        {
+            __m256i v = Ops::load256(keys + i);
+            bits += __builtin_popcount(KeysGreater ? Ops::gt256(v, k) : Ops::gt256(k, v));
+        }
+        int idx = bits / int(sizeof(Key));
+        for(; i < count; i++)
+            idx += KeysGreater ? (key < keys[i]) : (keys[i] < key);
+        return idx;
+    }
+
+    static int scalar(const Key* keys, int count, const Key& key)
+    {
+        int idx = 0;
+        for(int i = 0; i < count; i++)
+            idx += KeysGreater ? (key < keys[i]) : (keys[i] < key);
+        return idx;
+    }
+
+    static int run(const Key* keys, int count, const Key& key)
+    {
+        switch(getSimdLevel())
+        {
+        case SIMD_AVX2:
+            return avx2(keys, count, key);
+        case SIMD_SSE4:
+            return sse4(keys, count, key);
+        default:
+            return scalar(keys, count, key);
+        }
+    }
+};
+
+/**
+* In-node search for keys the vector units can compare directly.
+*/
+template <typename Key>
+struct BTreeSearch<Key, typename std::enable_if<SimdKeyOps<Key>::supported>::type>
+{
+    static int lowerBound(const Key* keys, int count, const Key& key)
+    {
+        return SimdCount<Key, false>::run(keys, count, key);
+    }
+    static int upperBound(const Key* keys, int count, const Key& key)
+    {
+        return count - SimdCount<Key, true>::run(keys, count, key);
+    }
+};
+
+#endif // BTREE_SIMD
+
+#endif
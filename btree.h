@@ -0,0 +1,647 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstddef>
+#include <utility>
+
+/**
+* Searching inside one node of a wide tree. keys holds count sorted keys.
+* The generic version counts matching keys with a loop that has no
+* data-dependent branches. Integer and floating point keys get a
+* hand-vectorized specialization, see btree-simd.h.
+*/
+template <typename Key, typename Enable = void>
+struct BTreeSearch
+{
+    // index of the first key that is not less than key
+    static int lowerBound(const Key* keys, int count, const Key& key)
+    {
+        int idx = 0;
+        for(int i = 0; i < count; i++)
+            idx += (keys[i] < key);
+        return idx;
+    }
+    // index of the first key that is greater than key
+    static int upperBound(const Key* keys, int count, const Key& key)
+    {
+        int idx = 0;
+        for(int i = 0; i < count; i++)
+            idx += !(key < keys[i]);
+        return idx;
+    }
+};
+
+/**
+* A B+-tree ordered map with the same interface as BinarySearchTree.
+*
+* Every node stores its keys in one contiguous array of NodeBytes bytes
+* (at least 4 keys), so a lookup loads a few cache lines per level instead
+* of one cache line per key. All items live in the leaves, which are linked
+* together so in-order scans just walk arrays.
+*
+* Key and Value must be default constructible and assignable. Iterators
+* give a pair of references (first = key, second = value) since keys and
+* values are stored in separate arrays.
+*/
+template <typename Key, typename Value, size_t NodeBytes = 256>
+class BTreeMap
+{
+public:
+    static const int Order = (NodeBytes / sizeof(Key) < 4) ? 4 : int(NodeBytes / sizeof(Key));
+
+    BTreeMap();
+    ~BTreeMap();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+
+protected:
+    struct BNode
+    {
+        bool leaf;
+        int count;
+        Key keys[Order];
+        explicit BNode(bool isLeaf) : leaf(isLeaf), count(0) { }
+    };
+    struct Leaf : public BNode
+    {
+        Value values[Order];
+        Leaf* prev;
+        Leaf* next;
+        Leaf() : BNode(true), prev(NULL), next(NULL) { }
+    };
+    struct Internal : public BNode
+    {
+        BNode* children[Order + 1];
+        Internal() : BNode(false) { }
+    };
+
+public:
+    /**
+    * An iterator over the leaves, in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::pair<const Key&, Value&> reference;
+        // lets it->first / it->second work on the reference pair
+        class pointer
+        {
+        public:
+            pointer(const reference& ref) : ref_(ref) { }
+            reference* operator->() { return &ref_; }
+        private:
+            reference ref_;
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class BTreeMap<Key, Value, NodeBytes>;
+        iterator(Leaf* leaf, int index);
+        Leaf* leaf_;
+        int index_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef BTreeSearch<Key> Search;
+    static const int MinKeys = (Order - 1) / 2;
+
+    Leaf* findLeaf(const Key& key) const;
+    bool insertHelper(BNode* n, const Key& key, const Value& value, Key& splitKey, BNode*& splitNode);
+    bool removeHelper(BNode* n, const Key& key);
+    void fixChild(Internal* parent, int idx);
+    void clearHelper(BNode* n);
+
+    BNode* root_;
+    Leaf* first_;   // leftmost leaf, where iteration starts
+    size_t size_;
+
+private:
+    BTreeMap(const BTreeMap&) = delete;
+    BTreeMap& operator=(const BTreeMap&) = delete;
+};
+
+/*
+  ------------------------------------------
+  Begin implementations for the iterator.
+  ------------------------------------------
+*/
+
+template<typename Key, typename Value, size_t NodeBytes>
+BTreeMap<Key, Value, NodeBytes>::iterator::iterator() : leaf_(NULL), index_(0)
+{
+
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+BTreeMap<Key, Value, NodeBytes>::iterator::iterator(Leaf* leaf, int index) : leaf_(leaf), index_(index)
+{
+
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator::reference
+BTreeMap<Key, Value, NodeBytes>::iterator::operator*() const
+{
+    return reference(leaf_->keys[index_], leaf_->values[index_]);
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator::pointer
+BTreeMap<Key, Value, NodeBytes>::iterator::operator->() const
+{
+    return pointer(**this);
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+bool BTreeMap<Key, Value, NodeBytes>::iterator::operator==(const iterator& rhs) const
+{
+    return leaf_ == rhs.leaf_ && index_ == rhs.index_;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+bool BTreeMap<Key, Value, NodeBytes>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Steps to the next slot of the leaf, or to the first slot of the next leaf.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator&
+BTreeMap<Key, Value, NodeBytes>::iterator::operator++()
+{
+    if(++index_ >= leaf_->count)
+    {
+        leaf_ = leaf_->next;
+        index_ = 0;
+    }
+    return *this;
+}
+
+/*
+  ------------------------------------------
+  End implementations for the iterator.
+  ------------------------------------------
+*/
+
+template<typename Key, typename Value, size_t NodeBytes>
+BTreeMap<Key, Value, NodeBytes>::BTreeMap() : root_(NULL), first_(NULL), size_(0)
+{
+
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+BTreeMap<Key, Value, NodeBytes>::~BTreeMap()
+{
+    clear();
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+bool BTreeMap<Key, Value, NodeBytes>::empty() const
+{
+    return size_ == 0;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+size_t BTreeMap<Key, Value, NodeBytes>::size() const
+{
+    return size_;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+void BTreeMap<Key, Value, NodeBytes>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+    first_ = NULL;
+    size_ = 0;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+void BTreeMap<Key, Value, NodeBytes>::clearHelper(BNode* n)
+{
+    if(n == NULL)
+        return;
+    if(n->leaf)
+    {
+        delete static_cast<Leaf*>(n);
+        return;
+    }
+    Internal* in = static_cast<Internal*>(n);
+    for(int i = 0; i <= in->count; i++)
+        clearHelper(in->children[i]);
+    delete in;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator
+BTreeMap<Key, Value, NodeBytes>::begin() const
+{
+    if(size_ == 0)
+        return end();
+    return iterator(first_, 0);
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator
+BTreeMap<Key, Value, NodeBytes>::end() const
+{
+    return iterator(NULL, 0);
+}
+
+/**
+* Descends to the only leaf that could hold key. The separator keys[i] of an
+* internal node is the smallest key stored under children[i+1].
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::Leaf*
+BTreeMap<Key, Value, NodeBytes>::findLeaf(const Key& key) const
+{
+    BNode* n = root_;
+    if(n == NULL)
+        return NULL;
+    while(!n->leaf)
+    {
+        Internal* in = static_cast<Internal*>(n);
+        n = in->children[Search::upperBound(in->keys, in->count, key)];
+    }
+    return static_cast<Leaf*>(n);
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator
+BTreeMap<Key, Value, NodeBytes>::find(const Key& key) const
+{
+    Leaf* leaf = findLeaf(key);
+    if(leaf == NULL)
+        return end();
+    int idx = Search::lowerBound(leaf->keys, leaf->count, key);
+    if(idx < leaf->count && !(key < leaf->keys[idx]))
+        return iterator(leaf, idx);
+    return end();
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than key,
+* the starting point for range scans.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+typename BTreeMap<Key, Value, NodeBytes>::iterator
+BTreeMap<Key, Value, NodeBytes>::lower_bound(const Key& key) const
+{
+    Leaf* leaf = findLeaf(key);
+    if(leaf == NULL)
+        return end();
+    int idx = Search::lowerBound(leaf->keys, leaf->count, key);
+    if(idx == leaf->count)
+        return iterator(leaf->next, 0);
+    return iterator(leaf, idx);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<typename Key, typename Value, size_t NodeBytes>
+Value& BTreeMap<Key, Value, NodeBytes>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+Value const & BTreeMap<Key, Value, NodeBytes>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/**
+* Inserts key/value, overwriting the value if key is already present.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+void BTreeMap<Key, Value, NodeBytes>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    if(root_ == NULL)
+    {
+        Leaf* leaf = new Leaf;
+        root_ = first_ = leaf;
+    }
+
+    Key splitKey;
+    BNode* splitNode = NULL;
+    if(insertHelper(root_, keyValuePair.first, keyValuePair.second, splitKey, splitNode))
+    {
+        //the root split, so the tree grows one level
+        Internal* newRoot = new Internal;
+        newRoot->count = 1;
+        newRoot->keys[0] = splitKey;
+        newRoot->children[0] = root_;
+        newRoot->children[1] = splitNode;
+        root_ = newRoot;
+    }
+}
+
+/**
+* Inserts into the subtree at n. Returns true if n had to split, in which
+* case splitNode is the new right sibling and splitKey its smallest key.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+bool BTreeMap<Key, Value, NodeBytes>::insertHelper(BNode* n, const Key& key, const Value& value,
+    Key& splitKey, BNode*& splitNode)
+{
+    if(n->leaf)
+    {
+        Leaf* leaf = static_cast<Leaf*>(n);
+        int pos = Search::lowerBound(leaf->keys, leaf->count, key);
+        if(pos < leaf->count && !(key < leaf->keys[pos]))
+        {
+            leaf->values[pos] = value;
+            return false;
+        }
+        size_++;
+
+        Leaf* target = leaf;
+        bool split = false;
+        if(leaf->count == Order) //full: move the upper half to a new leaf
+        {
+            Leaf* right = new Leaf;
+            int half = Order / 2;
+            for(int i = half; i < Order; i++)
+            {
+                right->keys[i - half] = leaf->keys[i];
+                right->values[i - half] = leaf->values[i];
+            }
+            right->count = Order - half;
+            leaf->count = half;
+            right->next = leaf->next;
+            if(right->next != NULL)
+                right->next->prev = right;
+            right->prev = leaf;
+            leaf->next = right;
+
+            if(pos > half)
+            {
+                target = right;
+                pos -= half;
+            }
+            splitNode = right;
+            split = true;
+        }
+
+        for(int i = target->count; i > pos; i--)
+        {
+            target->keys[i] = target->keys[i - 1];
+            target->values[i] = target->values[i - 1];
+        }
+        target->keys[pos] = key;
+        target->values[pos] = value;
+        target->count++;
+
+        if(split)
+            splitKey = static_cast<Leaf*>(splitNode)->keys[0];
+        return split;
+    }
+
+    Internal* in = static_cast<Internal*>(n);
+    int idx = Search::upperBound(in->keys, in->count, key);
+    Key childKey;
+    BNode* childSplit = NULL;
+    if(!insertHelper(in->children[idx], key, value, childKey, childSplit))
+        return false;
+
+    Internal* target = in;
+    bool split = false;
+    if(in->count == Order) //full: promote the middle key, move the rest right
+    {
+        Internal* right = new Internal;
+        int mid = Order / 2;
+        splitKey = in->keys[mid];
+        for(int i = mid + 1; i < Order; i++)
+            right->keys[i - mid - 1] = in->keys[i];
+        for(int i = mid + 1; i <= Order; i++)
+            right->children[i - mid - 1] = in->children[i];
+        right->count = Order - mid - 1;
+        in->count = mid;
+
+        if(idx > mid)
+        {
+            target = right;
+            idx -= mid + 1;
+        }
+        splitNode = right;
+        split = true;
+    }
+
+    for(int i = target->count; i > idx; i--)
+    {
+        target->keys[i] = target->keys[i - 1];
+        target->children[i + 1] = target->children[i];
+    }
+    target->keys[idx] = childKey;
+    target->children[idx + 1] = childSplit;
+    target->count++;
+    return split;
+}
+
+/**
+* Removes key if present. Underfull nodes borrow from or merge with
+* a sibling on the way back up, and the tree shrinks when the root empties.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+void BTreeMap<Key, Value, NodeBytes>::remove(const Key& key)
+{
+    if(root_ == NULL || !removeHelper(root_, key))
+        return;
+
+    if(!root_->leaf && root_->count == 0)
+    {
+        Internal* oldRoot = static_cast<Internal*>(root_);
+        root_ = oldRoot->children[0];
+        delete oldRoot;
+    }
+    else if(root_->leaf && root_->count == 0)
+    {
+        delete static_cast<Leaf*>(root_);
+        root_ = NULL;
+        first_ = NULL;
+    }
+}
+
+template<typename Key, typename Value, size_t NodeBytes>
+bool BTreeMap<Key, Value, NodeBytes>::removeHelper(BNode* n, const Key& key)
+{
+    if(n->leaf)
+    {
+        Leaf* leaf = static_cast<Leaf*>(n);
+        int pos = Search::lowerBound(leaf->keys, leaf->count, key);
+        if(pos == leaf->count || key < leaf->keys[pos])
+            return false;
+        for(int i = pos + 1; i < leaf->count; i++)
+        {
+            leaf->keys[i - 1] = leaf->keys[i];
+            leaf->values[i - 1] = leaf->values[i];
+        }
+        leaf->count--;
+        size_--;
+        return true;
+    }
+
+    Internal* in = static_cast<Internal*>(n);
+    int idx = Search::upperBound(in->keys, in->count, key);
+    if(!removeHelper(in->children[idx], key))
+        return false;
+    if(in->children[idx]->count < MinKeys)
+        fixChild(in, idx);
+    return true;
+}
+
+/**
+* Restores the minimum fill of parent->children[idx] by borrowing one entry
+* from a sibling that can spare it, or else merging with a sibling.
+*/
+template<typename Key, typename Value, size_t NodeBytes>
+void BTreeMap<Key, Value, NodeBytes>::fixChild(Internal* parent, int idx)
+{
+    BNode* child = parent->children[idx];
+    BNode* left = idx > 0 ? parent->children[idx - 1] : NULL;
+    BNode* right = idx < parent->count ? parent->children[idx + 1] : NULL;
+
+    if(child->leaf)
+    {
+        Leaf* c = static_cast<Leaf*>(child);
+        if(left != NULL && left->count > MinKeys) //borrow the largest item on the left
+        {
+            Leaf* l = static_cast<Leaf*>(left);
+            for(int i = c->count; i > 0; i--)
+            {
+                c->keys[i] = c->keys[i - 1];
+                c->values[i] = c->values[i - 1];
+            }
+            c->keys[0] = l->keys[l->count - 1];
+            c->values[0] = l->values[l->count - 1];
+            c->count++;
+            l->count--;
+            parent->keys[idx - 1] = c->keys[0];
+            return;
+        }
+        if(right != NULL && right->count > MinKeys) //borrow the smallest item on the right
+        {
+            Leaf* r = static_cast<Leaf*>(right);
+            c->keys[c->count] = r->keys[0];
+            c->values[c->count] = r->values[0];
+            c->count++;
+            for(int i = 1; i < r->count; i++)
+            {
+                r->keys[i - 1] = r->keys[i];
+                r->values[i - 1] = r->values[i];
+            }
+            r->count--;
+            parent->keys[idx] = r->keys[0];
+            return;
+        }
+    }
+    else
+    {
+        Internal* c = static_cast<Internal*>(child);
+        if(left != NULL && left->count > MinKeys) //rotate through the parent from the left
+        {
+            Internal* l = static_cast<Internal*>(left);
+            c->children[c->count + 1] = c->children[c->count];
+            for(int i = c->count; i > 0; i--)
+            {
+                c->keys[i] = c->keys[i - 1];
+                c->children[i] = c->children[i - 1];
+            }
+            c->keys[0] = parent->keys[idx - 1];
+            c->children[0] = l->children[l->count];
+            c->count++;
+            parent->keys[idx - 1] = l->keys[l->count - 1];
+            l->count--;
+            return;
+        }
+        if(right != NULL && right->count > MinKeys) //rotate through the parent from the right
+        {
+            Internal* r = static_cast<Internal*>(right);
+            c->keys[c->count] = parent->keys[idx];
+            c->children[c->count + 1] = r->children[0];
+            c->count++;
+            parent->keys[idx] = r->keys[0];
+            for(int i = 1; i < r->count; i++)
+                r->keys[i - 1] = r->keys[i];
+            for(int i = 1; i <= r->count; i++)
+                r->children[i - 1] = r->children[i];
+            r->count--;
+            return;
+        }
+    }
+
+    //no sibling can lend, so merge the pair children[sep], children[sep + 1]
+    int sep = (left != NULL) ? idx - 1 : idx;
+    BNode* a = parent->children[sep];
+    BNode* b = parent->children[sep + 1];
+    if(a->leaf)
+    {
+        Leaf* la = static_cast<Leaf*>(a);
+        Leaf* lb = static_cast<Leaf*>(b);
+        for(int i = 0; i < lb->count; i++)
+        {
+            la->keys[la->count + i] = lb->keys[i];
+            la->values[la->count + i] = lb->values[i];
+        }
+        la->count += lb->count;
+        la->next = lb->next;
+        if(la->next != NULL)
+            la->next->prev = la;
+        delete lb;
+    }
+    else
+    {
+        Internal* ia = static_cast<Internal*>(a);
+        Internal* ib = static_cast<Internal*>(b);
+        ia->keys[ia->count] = parent->keys[sep];
+        for(int i = 0; i < ib->count; i++)
+            ia->keys[ia->count + 1 + i] = ib->keys[i];
+        for(int i = 0; i <= ib->count; i++)
+            ia->children[ia->count + 1 + i] = ib->children[i];
+        ia->count += ib->count + 1;
+        delete ib;
+    }
+    for(int i = sep + 1; i < parent->count; i++)
+    {
+        parent->keys[i - 1] = parent->keys[i];
+        parent->children[i] = parent->children[i + 1];
+    }
+    parent->count--;
+}
+
+// SIMD in-node search for arithmetic keys (in its own file because it's fairly long)
+#include "btree-simd.h"
+
+#endif
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <vector>
+#include <utility>
+#include "equal-paths-parallel.h"
+#include "task-pool.h"
+using namespace std;
+
+namespace {
+
+// State shared by all tasks of one equalPathsParallel() call
+struct SharedCheck
+{
+    TaskPool* pool;
+    int cutoffDepth;
+    atomic<int> expected;   // leaf depth everyone must match, -1 until known
+    atomic<bool> mismatch;
+
+    SharedCheck(TaskPool* p, int cutoff) :
+        pool(p), cutoffDepth(cutoff), expected(-1), mismatch(false)
+    {}
+};
+
+// Returns false if depth disagrees with the shared leaf depth
+bool checkLeaf(SharedCheck& shared, int depth)
+{
+    int expected = shared.expected.load(memory_order_relaxed);
+    if(expected < 0 &&
+       shared.expected.compare_exchange_strong(expected, depth))
+        return true;
+    return expected == depth;
+}
+
+// Iterative walk of the subtree at root (which sits at depth) that forks
+// right children above the cutoff depth into new tasks
+void checkSubtree(SharedCheck& shared, Node* root, int depth)
+{
+    vector< pair<Node*, int> > stack;
+    stack.push_back(make_pair(root, depth));
+    unsigned visited = 0;
+
+    while(!stack.empty())
+    {
+        // poll for another task's mismatch now and then, not on every node
+        if((++visited & 255) == 0 && shared.mismatch.load(memory_order_relaxed))
+            return;
+
+        Node* n = stack.back().first;
+        int d = stack.back().second;
+        stack.pop_back();
+
+        if(n->left == NULL && n->right == NULL)
+        {
+            if(!checkLeaf(shared, d))
+            {
+                shared.mismatch.store(true);
+                return;
+            }
+            continue;
+        }
+        int expected = shared.expected.load(memory_order_relaxed);
+        if(expected >= 0 && d >= expected)
+        {
+            shared.mismatch.store(true);
+            return;
+        }
+        if(n->right != NULL)
+        {
+            if(d < shared.cutoffDepth && n->left != NULL)
+            {
+                Node* right = n->right;
+                int rightDepth = d + 1;
+                SharedCheck* s = &shared;
+                shared.pool->submit([s, right, rightDepth]() {
+                    checkSubtree(*s, right, rightDepth);
+                });
+            }
+            else
+                stack.push_back(make_pair(n->right, d + 1));
+        }
+        if(n->left != NULL)
+            stack.push_back(make_pair(n->left, d + 1));
+    }
+}
+
+}
+
+bool equalPathsParallel(Node * root, unsigned threads, int cutoffDepth)
+{
+    if(root == NULL)
+        return true;
+
+    TaskPool pool(threads);
+    if(cutoffDepth < 0)
+    {
+        // about 16 tasks per thread, enough to even out lopsided subtrees
+        cutoffDepth = 4;
+        for(unsigned t = pool.threads(); t > 1; t /= 2)
+            cutoffDepth++;
+    }
+
+    SharedCheck shared(&pool, cutoffDepth);
+    pool.submit([&shared, root]() { checkSubtree(shared, root, 0); });
+    pool.wait();
+    return !shared.mismatch.load();
+}
@@ -0,0 +1,21 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include "equal-paths.h"
+
+/**
+ * @brief Same result as equalPaths(), computed by several threads.
+ *
+ *        The top of the tree (down to cutoffDepth) is split into independent
+ *        subtrees that run as tasks on a work-stealing pool. The first leaf
+ *        depth found is shared through an atomic, and every task stops as
+ *        soon as any of them sees a mismatch.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param threads Number of worker threads, 0 for one per hardware thread
+ * @param cutoffDepth Depth above which subtrees are forked into tasks,
+ *        -1 to pick one from the thread count
+ */
+bool equalPathsParallel(Node * root, unsigned threads = 0, int cutoffDepth = -1);
+
+#endif
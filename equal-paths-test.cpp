@@ -1,9 +1,12 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
 #include "equal-paths.h"
+#include "equal-paths-parallel.h"
 using namespace std;
 
-
 Node* a;
 Node* b;
 Node* c;
@@ -55,22 +58,161 @@ void test5(const char* msg)
   cout << msg << ": " <<   equalPaths(a) << endl;
 }
 
-int main()
+// Builds a path of n nodes going left, with an extra leaf hanging
+// off the right of the node at depth sideDepth (none if sideDepth < 0)
+Node* makeChain(int n, int sideDepth)
+{
+  Node* root = new Node(0);
+  Node* curr = root;
+  for(int i = 1; i < n; i++)
+  {
+    curr->left = new Node(i);
+    if(i - 1 == sideDepth)
+      curr->right = new Node(-i);
+    curr = curr->left;
+  }
+  return root;
+}
+
+void deleteTree(Node* root)
+{
+  // iterative so deep chains are safe to free
+  while(root != NULL)
+  {
+    if(root->right != NULL)
+    {
+      Node* r = root->right;
+      root->right = r->left;
+      r->left = root;
+      root = r;
+    }
+    else
+    {
+      Node* next = root->left;
+      delete root;
+      root = next;
+    }
+  }
+}
+
+void test6(const char* msg)
+{
+  // a very deep chain: must not overflow the stack
+  Node* root = makeChain(2000000, -1);
+  cout << msg << ": " <<   equalPaths(root) << endl;
+  deleteTree(root);
+}
+
+void test7(const char* msg)
 {
+  // deep chain with a short branch near the top
+  Node* root = makeChain(2000000, 3);
+  cout << msg << ": " <<   equalPaths(root) << endl;
+  deleteTree(root);
+}
+
+void test8(const char* msg)
+{
+  // a short leaf under one child, then evened out below the other
+  setNode(a,1,b,c);
+  setNode(b,2,d,NULL);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  bool unequal = !equalPaths(a);
+  setNode(c,3,NULL,e);
+  setNode(e,5,NULL,NULL);
+  cout << msg << ": " << (unequal && equalPaths(a)) << endl;
+}
+
+Node* makePerfect(int height);
+
+void test9(const char* msg)
+{
+  // the parallel version agrees on a full tree and on one with a short leaf
+  Node* root = makePerfect(12);
+  bool full = equalPathsParallel(root, 4, 3);
+  Node* cut = root->right->right;
+  root->right->right = new Node(-1);
+  bool shortLeaf = equalPathsParallel(root, 4, 3);
+  deleteTree(cut);
+  cout << msg << ": " << (full && !shortLeaf) << endl;
+  deleteTree(root);
+}
+
+// Perfect tree of the given height (edges), so every leaf is at that depth
+Node* makePerfect(int height)
+{
+  Node* n = new Node(height);
+  if(height > 0)
+  {
+    n->left = makePerfect(height - 1);
+    n->right = makePerfect(height - 1);
+  }
+  return n;
+}
+
+double timeCheck(bool (*check)(Node*), Node* root, bool& result)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  result = check(root);
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned benchThreads;
+bool parallelCheck(Node* root)
+{
+  return equalPathsParallel(root, benchThreads);
+}
+
+// ./equal-paths-test bench [height]
+void benchmark(int height)
+{
+  Node* root = makePerfect(height);
+  cout << "perfect tree of height " << height << " (" << ((2L << height) - 1) << " nodes)" << endl;
+  bool result;
+  double base = timeCheck(equalPaths, root, result);
+  cout << "  equalPaths:            " << base << " ms (" << result << ")" << endl;
+
+  unsigned maxThreads = std::thread::hardware_concurrency();
+  if(maxThreads < 2)
+    maxThreads = 2;
+  for(benchThreads = 1; benchThreads <= maxThreads; benchThreads *= 2)
+  {
+    double ms = timeCheck(parallelCheck, root, result);
+    cout << "  equalPathsParallel x" << benchThreads << ": " << ms << " ms (" << result
+         << "), speedup " << base / ms << endl;
+  }
+  deleteTree(root);
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc > 1 && strcmp(argv[1], "bench") == 0)
+  {
+    benchmark(argc > 2 ? atoi(argv[2]) : 22);
+    return 0;
+  }
+
   a = new Node(1);
   b = new Node(2);
   c = new Node(3);
   d = new Node(4);
+  e = new Node(5);
 
   test1("Test1");
   test2("Test2");
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
+  test7("Test7");
+  test8("Test8");
+  test9("Test9");
  
   delete a;
   delete b;
   delete c;
   delete d;
+  delete e;
 }
 
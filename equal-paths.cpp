@@ -1,5 +1,7 @@
 #ifndef RECCHECK
 #include <algorithm>
+#include <vector>
+#include <utility>
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
 
 #endif
@@ -10,48 +12,98 @@ using namespace std;
 
 // You may add any prototypes of helper functions here
 
-int getPathLength(Node* n);
+static int leafDepth(Node* n, int budget);
+static bool equalPathsIterative(Node* root);
 
+// leafDepth results that are not depths
+static const int MISMATCH = -1;
+static const int TOO_DEEP = -2;
 
+// Deeper trees than this are checked without recursion
+static const int MAX_RECURSION = 10000;
+
+
+/**
+ * The recursive single pass, or the iterative walk for trees too deep to
+ * recurse on safely (millions of levels would overflow the call stack).
+ * The abandoned recursive attempt visits fewer nodes than the tree has,
+ * so either way this is O(n).
+ */
 bool equalPaths(Node * root)
 {
     if(root == NULL)
         return true;
-    if(root->right == NULL && root->left == NULL)
-        return true;
-    else if(root->right == NULL)
-        return equalPaths(root->left);
-    else if(root->left == NULL)
-        return equalPaths(root->right);
-    else
-    {
-        if(equalPaths(root->right) == equalPaths(root->left))
-        {
-            if(getPathLength(root->right) == getPathLength(root->left))
-                return true;
-        }
-    }
-    return false;
-
+    int depth = leafDepth(root, MAX_RECURSION);
+    if(depth == TOO_DEEP)
+        return equalPathsIterative(root);
+    return depth != MISMATCH;
 }
 
-int getPathLength(Node* n)
+/**
+ * Returns the depth (edges) shared by every leaf under n, or MISMATCH as
+ * soon as two leaves disagree. Each node is visited once and no subtree
+ * is ever measured twice. Gives up with TOO_DEEP once it would recurse
+ * more than budget levels.
+ */
+static int leafDepth(Node* n, int budget)
 {
-    int lenRight = 0;
-    int lenLeft = 0;
-    if(n->right == NULL && n->left == NULL)
+    if(n->left == NULL && n->right == NULL)
         return 0;
-    else
+    if(budget == 0)
+        return TOO_DEEP;
+    if(n->left == NULL)
     {
-        if(n->right != NULL)
-            lenRight = 1 + getPathLength(n->right);
-        if(n->left != NULL)
-            lenLeft = 1 + getPathLength(n->left);
-        return std::max(lenRight, lenLeft);
+        int d = leafDepth(n->right, budget - 1);
+        return d < 0 ? d : d + 1;
     }
-
-
+    int left = leafDepth(n->left, budget - 1);
+    if(left < 0)
+        return left;
+    if(n->right == NULL)
+        return left + 1;
+    int right = leafDepth(n->right, budget - 1);
+    if(right < 0)
+        return right;
+    if(right != left) //mismatch: stop here
+        return MISMATCH;
+    return left + 1;
 }
 
+/**
+ * Depth-first walk with an explicit stack of (node, depth). The first leaf
+ * found fixes the expected depth and the walk stops at the first leaf
+ * with a different one. O(n) time, no recursion.
+ */
+static bool equalPathsIterative(Node* root)
+{
+    if(root == NULL)
+        return true;
 
+    vector< pair<Node*, int> > stack;
+    stack.push_back(make_pair(root, 0));
+    int expected = -1;
 
+    while(!stack.empty())
+    {
+        Node* n = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if(n->left == NULL && n->right == NULL)
+        {
+            if(expected < 0)
+                expected = depth;
+            else if(depth != expected)
+                return false;
+            continue;
+        }
+        //a path longer than a known leaf depth can only end in a mismatch
+        if(expected >= 0 && depth >= expected)
+            return false;
+        if(n->right != NULL)
+            stack.push_back(make_pair(n->right, depth + 1));
+        if(n->left != NULL)
+            stack.push_back(make_pair(n->left, depth + 1));
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <iostream>
+#include "augavl.h"
+
+/**
+* A closed interval [start, end], the key type of IntervalTree. Ordered
+* by start, then end.
+*/
+template <class Point>
+struct Interval
+{
+    Point start;
+    Point end;
+
+    Interval(const Point& s, const Point& e) : start(s), end(e) {}
+    bool operator<(const Interval& rhs) const
+    {
+        return start < rhs.start || (!(rhs.start < start) && end < rhs.end);
+    }
+    bool operator>(const Interval& rhs) const { return rhs < *this; }
+    bool operator==(const Interval& rhs) const { return !(*this < rhs) && !(rhs < *this); }
+};
+
+template <class Point>
+std::ostream& operator<<(std::ostream& out, const Interval<Point>& interval)
+{
+    return out << '[' << interval.start << ',' << interval.end << ']';
+}
+
+/**
+* Monoid for IntervalTree: the largest end point of the intervals in a
+* subtree. Point must have std::numeric_limits (any arithmetic type).
+*/
+template <class Point>
+struct MaxEndMonoid
+{
+    typedef Point type;
+    static type identity() { return std::numeric_limits<Point>::lowest(); }
+    template <class Value>
+    static type lift(const Interval<Point>& interval, const Value&) { return interval.end; }
+    static type combine(const type& a, const type& b) { return a < b ? b : a; }
+};
+
+/**
+* Closed intervals [start, end] with a value each, in an AVL tree keyed by
+* (start, end), with every subtree's largest end kept by the augmentation
+* (so rotations, removes and rebalancing keep it current for free).
+* Several intervals may share a start; inserting an identical interval
+* again overwrites its value.
+*
+* A subtree whose largest end is before the query can be skipped whole,
+* and so can every right subtree once starts pass the query's end, so
+* overlap and stabbing queries cost O(log n + k) for k results.
+*/
+template <class Point, class Value>
+class IntervalTree : public AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point> >
+{
+public:
+    typedef Interval<Point> Key;
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    using AVLTree<Key, Value>::insert;
+    void insert(const Point& start, const Point& end, const Value& value);
+    using AVLTree<Key, Value>::remove;
+    void remove(const Point& start, const Point& end);
+
+    // Writes an iterator to out for every interval that overlaps [lo, hi]
+    // (shares at least one point with it), in (start, end) order.
+    template<class OutputIt>
+    OutputIt overlapping(const Point& lo, const Point& hi, OutputIt out) const;
+    // Intervals that contain point
+    template<class OutputIt>
+    OutputIt stabbing(const Point& point, OutputIt out) const;
+    bool overlaps_any(const Point& lo, const Point& hi) const;
+};
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert(const Point& start, const Point& end, const Value& value)
+{
+    if(end < start)
+        throw std::invalid_argument("Interval ends before it starts");
+    this->insert(std::make_pair(Key(start, end), value));
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::remove(const Point& start, const Point& end)
+{
+    this->remove(Key(start, end));
+}
+
+/**
+* Depth-first walk with an explicit stack. Only subtrees whose largest end
+* reaches lo are entered, and a right subtree only if its parent starts at
+* or before hi (starts only grow to the right).
+*/
+template<class Point, class Value>
+template<class OutputIt>
+OutputIt IntervalTree<Point, Value>::overlapping(const Point& lo, const Point& hi, OutputIt out) const
+{
+    std::vector<Node<Key, Value>*> stack;
+    stack.reserve(64);
+    Node<Key, Value>* n = this->root_;
+    while(true)
+    {
+        //go left while the left subtree can still hold an overlap
+        while(n != NULL && !(this->subtree(n) < lo))
+        {
+            stack.push_back(n);
+            n = n->getLeft();
+        }
+        if(stack.empty())
+            return out;
+        n = stack.back();
+        stack.pop_back();
+        if(hi < n->getKey().start)
+            return out; //n and everything after it start too late
+        if(!(n->getKey().end < lo) && !n->isTombstone())
+        {
+            *out = this->iteratorAt(n);
+            ++out;
+        }
+        n = n->getRight();
+    }
+}
+
+template<class Point, class Value>
+template<class OutputIt>
+OutputIt IntervalTree<Point, Value>::stabbing(const Point& point, OutputIt out) const
+{
+    return overlapping(point, point, out);
+}
+
+/**
+* True if any interval overlaps [lo, hi]. O(log n): follows a single path.
+*/
+template<class Point, class Value>
+bool IntervalTree<Point, Value>::overlaps_any(const Point& lo, const Point& hi) const
+{
+    Node<Key, Value>* n = this->root_;
+    while(n != NULL)
+    {
+        if(!n->isTombstone() && !(hi < n->getKey().start) && !(n->getKey().end < lo))
+            return true;
+        //if the left subtree reaches lo, it holds an overlap iff any does:
+        //its intervals start no later than everything to the right
+        Node<Key, Value>* left = n->getLeft();
+        if(left != NULL && !(this->subtree(left) < lo))
+            n = left;
+        else if(hi < n->getKey().start)
+            return false;
+        else
+            n = n->getRight();
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. Every access splays the touched key
+* to the root using top-down splaying, so repeatedly used ("hot") keys stay
+* near the top of the tree and are found in a handful of steps.
+*
+* Uses the plain Node class from bst.h (no extra per-node data) and the
+* BinarySearchTree iterator. Splaying is done iteratively so very deep trees
+* (e.g. after sorted inserts) cannot overflow the stack.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    virtual ~SplayTree();
+    using BinarySearchTree<Key, Value>::insert;
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+
+    // Lookups splay, so they are not const. The const versions inherited
+    // from BinarySearchTree still work (without splaying) on const trees.
+    using BinarySearchTree<Key, Value>::find;
+    using BinarySearchTree<Key, Value>::operator[];
+    iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+    // Splaying relinks nodes too freely to keep threads, so this throws
+    // std::logic_error when asked to enable threaded mode.
+    virtual void setThreaded(bool enabled);
+
+protected:
+    Node<Key, Value>* splay(const Key& key);
+    virtual void removeNode(Node<Key, Value>* n);
+    virtual void clearHelper(Node<Key, Value>* n);
+};
+
+/**
+* The base destructor cannot reach our non-recursive clearHelper, so clear here.
+*/
+template<class Key, class Value>
+SplayTree<Key, Value>::~SplayTree()
+{
+	this->clear();
+}
+
+template<class Key, class Value>
+void SplayTree<Key, Value>::setThreaded(bool enabled)
+{
+	if(enabled)
+		throw std::logic_error("SplayTree does not support threaded mode");
+}
+
+/**
+* Top-down splay. Walks down from the root towards key, peeling nodes off
+* into a "left tree" (everything smaller than key) and a "right tree"
+* (everything larger), doing a single rotation for zig-zig steps. At the
+* end the last node visited becomes the root with the two trees hung off of it.
+* Returns the new root, which holds key if key is in the tree, or else
+* one of its in-order neighbours.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::splay(const Key& key)
+{
+	Node<Key, Value>* t = this->root_;
+	if(t == NULL)
+		return NULL;
+
+	Node<Key, Value>* leftRoot = NULL;  //root of the tree of smaller keys
+	Node<Key, Value>* leftMax = NULL;   //its rightmost node, where we attach
+	Node<Key, Value>* rightRoot = NULL; //root of the tree of larger keys
+	Node<Key, Value>* rightMin = NULL;  //its leftmost node, where we attach
+
+	while(true)
+	{
+		if(key < t->getKey())
+		{
+			if(t->getLeft() == NULL)
+				break;
+			if(key < t->getLeft()->getKey()) //zig zig: rotate right first
+			{
+				Node<Key, Value>* y = t->getLeft();
+				t->setLeft(y->getRight());
+				if(y->getRight() != NULL)
+					y->getRight()->setParent(t);
+				y->setRight(t);
+				t->setParent(y);
+				t = y;
+				if(t->getLeft() == NULL)
+					break;
+			}
+			//link t into the right tree as its new minimum
+			if(rightMin == NULL)
+				rightRoot = t;
+			else
+			{
+				rightMin->setLeft(t);
+				t->setParent(rightMin);
+			}
+			rightMin = t;
+			t = t->getLeft();
+		}
+		else if(t->getKey() < key)
+		{
+			if(t->getRight() == NULL)
+				break;
+			if(t->getRight()->getKey() < key) //zig zig: rotate left first
+			{
+				Node<Key, Value>* y = t->getRight();
+				t->setRight(y->getLeft());
+				if(y->getLeft() != NULL)
+					y->getLeft()->setParent(t);
+				y->setLeft(t);
+				t->setParent(y);
+				t = y;
+				if(t->getRight() == NULL)
+					break;
+			}
+			//link t into the left tree as its new maximum
+			if(leftMax == NULL)
+				leftRoot = t;
+			else
+			{
+				leftMax->setRight(t);
+				t->setParent(leftMax);
+			}
+			leftMax = t;
+			t = t->getRight();
+		}
+		else
+			break;
+	}
+
+	//reassemble: t's subtrees go to the inner edges of the side trees
+	if(leftMax != NULL)
+	{
+		leftMax->setRight(t->getLeft());
+		if(t->getLeft() != NULL)
+			t->getLeft()->setParent(leftMax);
+		t->setLeft(leftRoot);
+		leftRoot->setParent(t);
+	}
+	if(rightMin != NULL)
+	{
+		rightMin->setLeft(t->getRight());
+		if(t->getRight() != NULL)
+			t->getRight()->setParent(rightMin);
+		t->setRight(rightRoot);
+		rightRoot->setParent(t);
+	}
+	t->setParent(NULL);
+	this->root_ = t;
+	return t;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	const Key& key = keyValuePair.first;
+	Node<Key, Value>* root = splay(key);
+
+	if(root != NULL && !(key < root->getKey()) && !(root->getKey() < key))
+	{
+		root->setValue(keyValuePair.second);
+		return;
+	}
+
+	Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
+	this->size_++;
+	this->cacheExtremes(newNode);
+	if(root != NULL)
+	{
+		//the splayed root is a neighbour of key, so split around it
+		if(key < root->getKey())
+		{
+			newNode->setLeft(root->getLeft());
+			if(root->getLeft() != NULL)
+				root->getLeft()->setParent(newNode);
+			root->setLeft(NULL);
+			newNode->setRight(root);
+		}
+		else
+		{
+			newNode->setRight(root->getRight());
+			if(root->getRight() != NULL)
+				root->getRight()->setParent(newNode);
+			root->setRight(NULL);
+			newNode->setLeft(root);
+		}
+		root->setParent(newNode);
+	}
+	this->root_ = newNode;
+}
+
+/*
+ * Splays key to the root, then joins its two subtrees by splaying the
+ * largest key of the left subtree to its top and hanging the right subtree
+ * off of it.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::remove(const Key& key)
+{
+	Node<Key, Value>* root = splay(key);
+
+	if(root == NULL || key < root->getKey() || root->getKey() < key)
+		return;
+
+	this->uncacheExtremes(root);
+	Node<Key, Value>* left = root->getLeft();
+	Node<Key, Value>* right = root->getRight();
+
+	if(left == NULL)
+	{
+		this->root_ = right;
+		if(right != NULL)
+			right->setParent(NULL);
+	}
+	else
+	{
+		left->setParent(NULL);
+		this->root_ = left;
+		//key is larger than everything left (and may live in root, so
+		//root is only freed afterwards)
+		Node<Key, Value>* newRoot = splay(key);
+		newRoot->setRight(right);
+		if(right != NULL)
+			right->setParent(newRoot);
+	}
+	delete root;
+	this->size_--;
+}
+
+/**
+* Returns an iterator to the item with the given key (splaying it to the
+* root) or the end iterator if it is not in the tree.
+*/
+template<class Key, class Value>
+typename SplayTree<Key, Value>::iterator
+SplayTree<Key, Value>::find(const Key& key)
+{
+	Node<Key, Value>* root = splay(key);
+	if(root == NULL || key < root->getKey() || root->getKey() < key)
+		return this->end();
+	return this->BinarySearchTree<Key, Value>::find(key); //O(1): key is at the root
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key, splaying it to the root
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+	Node<Key, Value>* root = splay(key);
+	if(root == NULL || key < root->getKey() || root->getKey() < key)
+		throw std::out_of_range("Invalid key");
+	return root->getValue();
+}
+
+/**
+* Splay trees always remove through the root, so unlinking a known node
+* splays its key up first.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::removeNode(Node<Key, Value>* n)
+{
+	remove(n->getKey());
+}
+
+/**
+* Frees a subtree without recursion by rotating left children up until
+* there are none, so degenerate splay trees can be cleared safely.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::clearHelper(Node<Key, Value>* n)
+{
+	while(n != NULL)
+	{
+		if(n->getLeft() != NULL)
+		{
+			Node<Key, Value>* l = n->getLeft();
+			n->setLeft(l->getRight());
+			l->setRight(n);
+			n = l;
+		}
+		else
+		{
+			Node<Key, Value>* r = n->getRight();
+			delete n;
+			n = r;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/**
+* A small work-stealing thread pool for fork/join style tree algorithms.
+*
+* Every worker has its own task deque. A task submitted from inside a
+* worker goes on that worker's deque, and the worker runs its newest task
+* first, so forked subtrees stay on the core that has them cached. Idle
+* workers steal the oldest task (usually the largest piece of work) from
+* the others. Tasks submitted from outside the pool are dealt round-robin.
+*
+* wait() blocks until every submitted task, including tasks that tasks
+* submitted, has finished. Only call it from outside the pool.
+*/
+class TaskPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    // threads == 0 means one per hardware thread
+    explicit TaskPool(unsigned threads = 0);
+    ~TaskPool();
+
+    void submit(const Task& task);
+    void wait();
+    unsigned threads() const;
+
+private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned self);
+    bool take(unsigned self, Task& task);
+    static TaskPool*& currentPool();
+    static unsigned& currentWorker();
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> pending_;   // submitted but not finished
+    std::atomic<size_t> queued_;    // submitted but not started
+    std::atomic<unsigned> nextWorker_;
+    std::mutex sleepLock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stop_;
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+};
+
+inline TaskPool::TaskPool(unsigned threads) :
+    pending_(0), queued_(0), nextWorker_(0), stop_(false)
+{
+    if(threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if(threads == 0)
+        threads = 1;
+    for(unsigned i = 0; i < threads; i++)
+        workers_.push_back(std::unique_ptr<Worker>(new Worker));
+    for(unsigned i = 0; i < threads; i++)
+        threads_.push_back(std::thread(&TaskPool::run, this, i));
+}
+
+inline TaskPool::~TaskPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for(size_t i = 0; i < threads_.size(); i++)
+        threads_[i].join();
+}
+
+inline unsigned TaskPool::threads() const
+{
+    return unsigned(workers_.size());
+}
+
+// The pool and worker index of the calling thread (NULL outside any pool)
+inline TaskPool*& TaskPool::currentPool()
+{
+    static thread_local TaskPool* pool = NULL;
+    return pool;
+}
+
+inline unsigned& TaskPool::currentWorker()
+{
+    static thread_local unsigned worker = 0;
+    return worker;
+}
+
+inline void TaskPool::submit(const Task& task)
+{
+    unsigned target;
+    if(currentPool() == this)
+        target = currentWorker();
+    else
+        target = nextWorker_.fetch_add(1) % workers_.size();
+
+    pending_++;
+    //counted before it is visible, so a worker taking it can never
+    //decrement queued_ below zero
+    queued_++;
+    {
+        std::lock_guard<std::mutex> guard(workers_[target]->lock);
+        workers_[target]->tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+    }
+    wake_.notify_one();
+}
+
+inline void TaskPool::wait()
+{
+    std::unique_lock<std::mutex> guard(sleepLock_);
+    while(pending_.load() != 0)
+        done_.wait(guard);
+}
+
+/**
+* Pops our own newest task, or steals the oldest task of another worker.
+*/
+inline bool TaskPool::take(unsigned self, Task& task)
+{
+    {
+        Worker& mine = *workers_[self];
+        std::lock_guard<std::mutex> guard(mine.lock);
+        if(!mine.tasks.empty())
+        {
+            task.swap(mine.tasks.back());
+            mine.tasks.pop_back();
+            queued_--;
+            return true;
+        }
+    }
+    for(size_t i = 1; i < workers_.size(); i++)
+    {
+        Worker& victim = *workers_[(self + i) % workers_.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(!victim.tasks.empty())
+        {
+            task.swap(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void TaskPool::run(unsigned self)
+{
+    currentPool() = this;
+    currentWorker() = self;
+    Task task;
+    while(true)
+    {
+        if(take(self, task))
+        {
+            task();
+            task = Task();
+            if(--pending_ == 0)
+            {
+                std::lock_guard<std::mutex> guard(sleepLock_);
+                done_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock_);
+        while(!stop_ && queued_.load() == 0)
+            wake_.wait(guard);
+        if(stop_ && queued_.load() == 0)
+            return;
+    }
+}
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef VALUE_STORAGE_H
+#define VALUE_STORAGE_H
+
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+
+/**
+* Where Node keeps its (key, value) pair. By default the pair is inside
+* the node. A value much larger than a cache line pushes the links of a
+* node far from its key and makes every node of a descent span several
+* lines; for such a value type, opt in to keeping the pairs out of line
+* in an ItemPool, where the node has only a pointer to the pair plus its
+* own copy of the key. Searches then read just the node, and
+* getItem()/getValue() and iterators still hand out references into the
+* pooled pair. Inserts and removes pay for the pool's lock, e.g.
+*   template<> struct ValueStorage<Blob> { static const bool outOfLine = true; };
+*/
+template <class Value>
+struct ValueStorage
+{
+    static const bool outOfLine = false;
+};
+
+/**
+* A pool of (key, value) pairs of one type, shared by every tree that
+* uses it. Pairs are carved out of slabs that double in size up to 4096
+* pairs, so pairs inserted together sit together, and freed pairs are
+* reused before a new slab is made. Slabs are never handed back; nodes of
+* static trees may still use them during static destruction. Trees on
+* different threads can share the pool, so it takes a lock.
+*/
+template <class Key, class Value>
+class ItemPool
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+
+    static ItemPool<Key, Value>& instance();
+
+    Item* allocate(const Key& key, const Value& value);
+    void release(Item* item);
+
+private:
+    union Slot
+    {
+        Slot* next;
+        typename std::aligned_storage<sizeof(Item), alignof(Item)>::type storage;
+    };
+
+    ItemPool();
+    Slot* takeSlot();
+    void putSlot(Slot* slot);
+
+    std::mutex lock_;
+    Slot* free_;
+    size_t nextSlab_;   // slots in the next slab
+    std::vector<Slot*> slabs_;
+
+    ItemPool(const ItemPool&) = delete;
+    ItemPool& operator=(const ItemPool&) = delete;
+};
+
+template<class Key, class Value>
+ItemPool<Key, Value>::ItemPool() : free_(NULL), nextSlab_(64)
+{
+
+}
+
+// Never destroyed (see above)
+template<class Key, class Value>
+ItemPool<Key, Value>& ItemPool<Key, Value>::instance()
+{
+    static ItemPool<Key, Value>* pool = new ItemPool<Key, Value>;
+    return *pool;
+}
+
+template<class Key, class Value>
+typename ItemPool<Key, Value>::Slot* ItemPool<Key, Value>::takeSlot()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    if(free_ == NULL)
+    {
+        Slot* slab = static_cast<Slot*>(::operator new(nextSlab_ * sizeof(Slot)));
+        slabs_.push_back(slab);
+        //chain the new slots so the lowest address is handed out first
+        for(size_t i = nextSlab_; i-- > 0; )
+        {
+            slab[i].next = free_;
+            free_ = &slab[i];
+        }
+        if(nextSlab_ < 4096)
+            nextSlab_ *= 2;
+    }
+    Slot* slot = free_;
+    free_ = slot->next;
+    return slot;
+}
+
+template<class Key, class Value>
+void ItemPool<Key, Value>::putSlot(Slot* slot)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    slot->next = free_;
+    free_ = slot;
+}
+
+template<class Key, class Value>
+typename ItemPool<Key, Value>::Item* ItemPool<Key, Value>::allocate(const Key& key, const Value& value)
+{
+    Slot* slot = takeSlot();
+    try
+    {
+        return new (&slot->storage) Item(key, value);
+    }
+    catch(...)
+    {
+        putSlot(slot);
+        throw;
+    }
+}
+
+template<class Key, class Value>
+void ItemPool<Key, Value>::release(Item* item)
+{
+    item->~Item();
+    putSlot(reinterpret_cast<Slot*>(item));
+}
+
+/**
+* The item storage a Node inherits: item_ is the pair itself, or (for
+* out-of-line values) a pointer to the pooled pair next to a copy of the
+* key.
+*/
+template <class Key, class Value, bool OutOfLine = ValueStorage<Value>::outOfLine>
+class NodeItem
+{
+public:
+    NodeItem(const Key& key, const Value& value);
+
+    const Key& key() const;
+    const std::pair<const Key, Value>& item() const;
+    std::pair<const Key, Value>& item();
+
+protected:
+    std::pair<const Key, Value> item_;
+};
+
+template<class Key, class Value, bool OutOfLine>
+NodeItem<Key, Value, OutOfLine>::NodeItem(const Key& key, const Value& value) :
+    item_(key, value)
+{
+
+}
+
+template<class Key, class Value, bool OutOfLine>
+const Key& NodeItem<Key, Value, OutOfLine>::key() const
+{
+    return item_.first;
+}
+
+template<class Key, class Value, bool OutOfLine>
+const std::pair<const Key, Value>& NodeItem<Key, Value, OutOfLine>::item() const
+{
+    return item_;
+}
+
+template<class Key, class Value, bool OutOfLine>
+std::pair<const Key, Value>& NodeItem<Key, Value, OutOfLine>::item()
+{
+    return item_;
+}
+
+template <class Key, class Value>
+class NodeItem<Key, Value, true>
+{
+public:
+    NodeItem(const Key& key, const Value& value);
+    ~NodeItem();
+
+    const Key& key() const;
+    const std::pair<const Key, Value>& item() const;
+    std::pair<const Key, Value>& item();
+
+protected:
+    const Key key_;
+    std::pair<const Key, Value>* item_;
+
+private:
+    NodeItem(const NodeItem&) = delete;
+    NodeItem& operator=(const NodeItem&) = delete;
+};
+
+template<class Key, class Value>
+NodeItem<Key, Value, true>::NodeItem(const Key& key, const Value& value) :
+    key_(key), item_(ItemPool<Key, Value>::instance().allocate(key, value))
+{
+
+}
+
+template<class Key, class Value>
+NodeItem<Key, Value, true>::~NodeItem()
+{
+    ItemPool<Key, Value>::instance().release(item_);
+}
+
+template<class Key, class Value>
+const Key& NodeItem<Key, Value, true>::key() const
+{
+    return key_;
+}
+
+template<class Key, class Value>
+const std::pair<const Key, Value>& NodeItem<Key, Value, true>::item() const
+{
+    return *item_;
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& NodeItem<Key, Value, true>::item()
+{
+    return *item_;
+}
+
+#endif